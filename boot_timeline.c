@@ -0,0 +1,78 @@
+/**
+ * @file boot_timeline.c
+ * @brief Boot timeline recording implementation
+ */
+
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "boot_timeline.h"
+
+static const char *TAG = "boot_timeline";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static boot_timeline_entry_t s_entries[BOOT_TIMELINE_MAX_ENTRIES];
+static uint8_t s_count = 0;
+static atomic_bool s_forwarding = false;
+
+void boot_timeline_mark(const char *name, esp_err_t result)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_count < BOOT_TIMELINE_MAX_ENTRIES) {
+        s_entries[s_count].name = name;
+        s_entries[s_count].time_us = now;
+        s_entries[s_count].result = result;
+        s_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void boot_timeline_first_forward(void)
+{
+    if (atomic_load_explicit(&s_forwarding, memory_order_relaxed)) {
+        return;
+    }
+    if (!atomic_exchange(&s_forwarding, true)) {
+        boot_timeline_mark("first_forward", ESP_OK);
+    }
+}
+
+bool boot_timeline_forwarding(void)
+{
+    return atomic_load_explicit(&s_forwarding, memory_order_relaxed);
+}
+
+esp_err_t boot_timeline_get(boot_timeline_entry_t *entries, uint8_t max_entries, uint8_t *count)
+{
+    if (entries == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    uint8_t n = s_count < max_entries ? s_count : max_entries;
+    for (uint8_t i = 0; i < n; i++) {
+        entries[i] = s_entries[i];
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    *count = n;
+    return ESP_OK;
+}
+
+void boot_timeline_log(void)
+{
+    boot_timeline_entry_t entries[BOOT_TIMELINE_MAX_ENTRIES];
+    uint8_t count = 0;
+
+    boot_timeline_get(entries, BOOT_TIMELINE_MAX_ENTRIES, &count);
+
+    ESP_LOGI(TAG, "Boot timeline (%d entries):", count);
+    for (uint8_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "  %8lld us  %-20s %s", (long long)entries[i].time_us, entries[i].name,
+                 entries[i].result == ESP_OK ? "ok" : esp_err_to_name(entries[i].result));
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * @file boot_timeline.h
+ * @brief Boot timeline recording
+ *
+ * This file contains the declarations for recording the time at which each
+ * boot stage completes, including the time to the first forwarded HID
+ * output, so boot latency can be tracked across releases.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of boot timeline entries
+ */
+#define BOOT_TIMELINE_MAX_ENTRIES 24
+
+/**
+ * @brief Boot timeline entry
+ */
+typedef struct {
+    const char *name;                /*!< Stage name (static string) */
+    int64_t time_us;                 /*!< Time since boot in microseconds */
+    esp_err_t result;                /*!< Result of the stage */
+} boot_timeline_entry_t;
+
+/**
+ * @brief Record the completion of a boot stage
+ *
+ * Safe to call from multiple tasks. Entries beyond BOOT_TIMELINE_MAX_ENTRIES
+ * are ignored.
+ *
+ * @param name Stage name (must be a static string)
+ * @param result Result of the stage
+ */
+void boot_timeline_mark(const char *name, esp_err_t result);
+
+/**
+ * @brief Record the first forwarded output
+ *
+ * Cheap after the first call; intended to be called from an output path on
+ * every successful output. Called by the CAN to HID flush task when an output
+ * report reaches a device.
+ */
+void boot_timeline_first_forward(void);
+
+/**
+ * @brief Check whether the first forwarded output has been recorded
+ *
+ * @return bool true once boot_timeline_first_forward() has been called
+ */
+bool boot_timeline_forwarding(void);
+
+/**
+ * @brief Get the recorded boot timeline
+ *
+ * @param[out] entries Array to store the entries
+ * @param max_entries Size of the array
+ * @param[out] count Pointer to store the number of entries copied
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t boot_timeline_get(boot_timeline_entry_t *entries, uint8_t max_entries, uint8_t *count);
+
+/**
+ * @brief Log the boot timeline
+ */
+void boot_timeline_log(void);
+
+#ifdef __cplusplus
+}
+#endif
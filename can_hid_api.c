@@ -0,0 +1,188 @@
+/**
+ * @file can_hid_api.c
+ * @brief Web API endpoints for CAN to HID output mappings
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+
+#include "can_hid_api.h"
+#include "can_hid_output.h"
+
+static const char *TAG = "can_hid_api";
+
+// Largest accepted form body for POST /api/can_hid/mappings
+#define CAN_HID_MAX_FORM_SIZE 384
+
+// Read an unsigned form field; missing fields keep the default
+static bool form_field(const char *form, const char *key, uint32_t max, uint32_t def, uint32_t *out)
+{
+    char value[16];
+    char *end;
+
+    if (httpd_query_key_value(form, key, value, sizeof(value)) != ESP_OK) {
+        *out = def;
+        return true;
+    }
+    unsigned long v = strtoul(value, &end, 0);
+    if (end == value || *end != '\0' || v > max) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+static esp_err_t mappings_get_handler(httpd_req_t *req)
+{
+    char buf[256];
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send_chunk(req, "[", 1);
+
+    bool first = true;
+    for (uint16_t i = 0; i < MAX_CAN_HID_MAPPINGS; i++) {
+        can_hid_mapping_t m;
+        if (can_hid_output_get(i, &m) != ESP_OK) {
+            continue;
+        }
+        int len = snprintf(buf, sizeof(buf),
+                           "%s{\"id\":%u,\"enabled\":%s,\"can_id\":%lu,\"extended_id\":%s,"
+                           "\"can_byte\":%u,\"can_mask\":%u,\"invert\":%s,\"as_flag\":%s,"
+                           "\"device_idx\":%u,\"report_id\":%u,\"report_size\":%u,"
+                           "\"report_byte\":%u,\"report_mask\":%u}",
+                           first ? "" : ",", i, m.enabled ? "true" : "false", (unsigned long)m.can_id,
+                           m.extended_id ? "true" : "false", m.can_byte, m.can_mask,
+                           m.invert ? "true" : "false", m.as_flag ? "true" : "false", m.device_idx,
+                           m.report_id, m.report_size, m.report_byte, m.report_mask);
+        httpd_resp_send_chunk(req, buf, len);
+        first = false;
+    }
+
+    httpd_resp_send_chunk(req, "]", 1);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t mappings_post_handler(httpd_req_t *req)
+{
+    char form[CAN_HID_MAX_FORM_SIZE + 1];
+    char resp[32];
+
+    if (req->content_len == 0 || req->content_len > CAN_HID_MAX_FORM_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid mapping form");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, form + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    form[received] = '\0';
+
+    uint32_t enabled, can_id, extended_id, can_byte, can_mask, invert, as_flag;
+    uint32_t device_idx, report_id, report_size, report_byte, report_mask;
+    bool ok = form_field(form, "enabled", 1, 1, &enabled) &&
+              form_field(form, "can_id", 0x1FFFFFFF, UINT32_MAX, &can_id) &&
+              form_field(form, "extended_id", 1, 0, &extended_id) &&
+              form_field(form, "can_byte", 7, 0, &can_byte) &&
+              form_field(form, "can_mask", 0xFF, 0xFF, &can_mask) &&
+              form_field(form, "invert", 1, 0, &invert) &&
+              form_field(form, "as_flag", 1, 0, &as_flag) &&
+              form_field(form, "device_idx", MAX_HID_DEVICES - 1, 0, &device_idx) &&
+              form_field(form, "report_id", 0xFF, 0, &report_id) &&
+              form_field(form, "report_size", CAN_HID_MAX_REPORT_SIZE, 1, &report_size) &&
+              form_field(form, "report_byte", CAN_HID_MAX_REPORT_SIZE - 1, 0, &report_byte) &&
+              form_field(form, "report_mask", 0xFF, 0xFF, &report_mask) &&
+              can_id != UINT32_MAX;
+    if (!ok) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid or missing mapping field");
+        return ESP_FAIL;
+    }
+
+    can_hid_mapping_t mapping = {
+        .enabled = enabled,
+        .can_id = can_id,
+        .extended_id = extended_id,
+        .can_byte = can_byte,
+        .can_mask = can_mask,
+        .invert = invert,
+        .as_flag = as_flag,
+        .device_idx = device_idx,
+        .report_id = report_id,
+        .report_size = report_size,
+        .report_byte = report_byte,
+        .report_mask = report_mask
+    };
+    uint16_t idx;
+    esp_err_t ret = can_hid_output_add(&mapping, &idx);
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            ret == ESP_ERR_NO_MEM ? "Mapping table full" : "Mapping rejected");
+        return ret;
+    }
+
+    snprintf(resp, sizeof(resp), "{\"id\":%u}", idx);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t mappings_delete_handler(httpd_req_t *req)
+{
+    char query[32];
+    uint32_t idx;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        !form_field(query, "id", MAX_CAN_HID_MAPPINGS - 1, UINT32_MAX, &idx) || idx == UINT32_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid id");
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = can_hid_output_remove(idx);
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such mapping");
+        return ret;
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, "{\"status\":\"ok\"}", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t save_post_handler(httpd_req_t *req)
+{
+    esp_err_t ret = can_hid_output_save();
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save mappings");
+        return ret;
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, "{\"status\":\"ok\"}", HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t can_hid_output_register_handlers(httpd_handle_t server)
+{
+    if (server == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const httpd_uri_t uris[] = {
+        { .uri = "/api/can_hid/mappings", .method = HTTP_GET, .handler = mappings_get_handler },
+        { .uri = "/api/can_hid/mappings", .method = HTTP_POST, .handler = mappings_post_handler },
+        { .uri = "/api/can_hid/mappings", .method = HTTP_DELETE, .handler = mappings_delete_handler },
+        { .uri = "/api/can_hid/save", .method = HTTP_POST, .handler = save_post_handler },
+    };
+
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        esp_err_t ret = httpd_register_uri_handler(server, &uris[i]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register %s (%s)", uris[i].uri, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
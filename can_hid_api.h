@@ -0,0 +1,34 @@
+/**
+ * @file can_hid_api.h
+ * @brief Web API endpoints for CAN to HID output mappings
+ *
+ * Kept apart from can_hid_output.h so the mapping core does not depend on
+ * the HTTP server.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register the CAN to HID mapping endpoints with the web server
+ *
+ * - `GET /api/can_hid/mappings`: list mappings as JSON
+ * - `POST /api/can_hid/mappings`: add a mapping from form fields named after
+ *   the can_hid_mapping_t members (`can_id` is required)
+ * - `DELETE /api/can_hid/mappings?id=N`: remove a mapping
+ * - `POST /api/can_hid/save`: save the mappings to non-volatile storage
+ *
+ * @param server HTTP server handle
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_register_handlers(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,652 @@
+/**
+ * @file can_hid_output.c
+ * @brief CAN to HID output report mapping implementation
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "nvs.h"
+#include "esp_log.h"
+
+#include "can_hid_output.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "boot_timeline.h"
+
+static const char *TAG = "can_hid_output";
+
+// Hash table size (power of two, at least twice the mapping count so probes stay short)
+#define CAN_HID_HASH_BITS 6
+#define CAN_HID_HASH_SIZE (1 << CAN_HID_HASH_BITS)
+#define CAN_HID_NO_ENTRY 0xFF
+
+// Extended IDs are 29 bits, so bit 31 is free to distinguish them from standard IDs
+#define CAN_HID_KEY(id, extended) (((id) & 0x1FFFFFFF) | ((extended) ? 0x80000000u : 0))
+
+// Receive timeout, also bounds how long the receive task takes to notice deinit
+#define CAN_HID_RX_TIMEOUT_MS 100
+
+// Set by each task as its last action, so deinit knows when shared state is free
+#define CAN_HID_RX_EXITED_BIT BIT0
+#define CAN_HID_FLUSH_EXITED_BIT BIT1
+
+// NVS storage; bump the version whenever can_hid_mapping_t changes layout
+#define CAN_HID_NVS_NAMESPACE "can_hid"
+#define CAN_HID_NVS_KEY_VERSION "version"
+#define CAN_HID_NVS_KEY_MAPPINGS "mappings"
+#define CAN_HID_NVS_VERSION 1
+
+typedef struct {
+    uint32_t key;                    // CAN_HID_KEY of the frame ID
+    uint8_t head;                    // First mapping index for this ID, CAN_HID_NO_ENTRY if empty
+} can_hid_hash_entry_t;
+
+typedef struct {
+    bool configured;                 // At least one mapping targets this device
+    uint8_t report_id;
+    uint8_t report_size;
+    uint8_t data[CAN_HID_MAX_REPORT_SIZE];
+    bool dirty;                      // Report changed since the last transfer
+    uint32_t generation;             // Incremented on every change, detects updates during a transfer
+} can_hid_device_report_t;
+
+static can_hid_output_config_t s_config;
+static bool s_initialized = false;
+static volatile bool s_running = false;
+
+// Configuration API serialisation (add/remove/clear)
+static SemaphoreHandle_t s_mutex = NULL;
+
+// Guards the dispatch tables, device reports and statistics, shared between
+// the receive task and the flush task
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static can_hid_mapping_t s_mappings[MAX_CAN_HID_MAPPINGS];
+static bool s_in_use[MAX_CAN_HID_MAPPINGS];
+
+// Precomputed dispatch: frame ID -> chain of mapping indices
+static can_hid_hash_entry_t s_hash[CAN_HID_HASH_SIZE];
+static uint8_t s_next[MAX_CAN_HID_MAPPINGS];
+
+static can_hid_device_report_t s_reports[MAX_HID_DEVICES];
+static can_hid_output_stats_t s_stats;
+
+static TaskHandle_t s_rx_task = NULL;
+static TaskHandle_t s_flush_task = NULL;
+
+// Created once and never deleted: a task may still be returning from
+// xEventGroupSetBits() when the waiter wakes up
+static EventGroupHandle_t s_task_events = NULL;
+
+static inline uint32_t hash_slot(uint32_t key)
+{
+    // Fibonacci hashing
+    return (key * 2654435761u) >> (32 - CAN_HID_HASH_BITS);
+}
+
+static int lowest_bit(uint8_t mask)
+{
+    return mask ? __builtin_ctz(mask) : 0;
+}
+
+// Find the hash entry for a key, or the empty slot where it would be inserted
+static can_hid_hash_entry_t *hash_lookup(can_hid_hash_entry_t *table, uint32_t key)
+{
+    uint32_t slot = hash_slot(key);
+    for (int probe = 0; probe < CAN_HID_HASH_SIZE; probe++) {
+        can_hid_hash_entry_t *entry = &table[slot];
+        if (entry->head == CAN_HID_NO_ENTRY || entry->key == key) {
+            return entry;
+        }
+        slot = (slot + 1) & (CAN_HID_HASH_SIZE - 1);
+    }
+    return NULL;
+}
+
+// Rebuild the dispatch tables and device report layout from a mapping list and
+// publish the list together with the tables, so the receive task never walks a
+// chain from one list over the entries of another. Report bits no longer owned by an enabled mapping are cleared and sent, so
+// removing or disabling a mapping does not leave its output (an LED, rumble)
+// stuck on the device. Must be called with s_mutex held.
+static void rebuild_tables(const can_hid_mapping_t *mappings, const bool *in_use)
+{
+    can_hid_hash_entry_t hash[CAN_HID_HASH_SIZE];
+    uint8_t next[MAX_CAN_HID_MAPPINGS];
+    can_hid_device_report_t layout[MAX_HID_DEVICES];
+    uint8_t owned[MAX_HID_DEVICES][CAN_HID_MAX_REPORT_SIZE];
+
+    memset(hash, 0, sizeof(hash));
+    for (int i = 0; i < CAN_HID_HASH_SIZE; i++) {
+        hash[i].head = CAN_HID_NO_ENTRY;
+    }
+    memset(next, CAN_HID_NO_ENTRY, sizeof(next));
+    memset(layout, 0, sizeof(layout));
+    memset(owned, 0, sizeof(owned));
+
+    // Insert in reverse so chains are walked in mapping index order
+    for (int i = MAX_CAN_HID_MAPPINGS - 1; i >= 0; i--) {
+        const can_hid_mapping_t *m = &mappings[i];
+        if (!in_use[i] || !m->enabled) {
+            continue;
+        }
+
+        can_hid_hash_entry_t *entry = hash_lookup(hash, CAN_HID_KEY(m->can_id, m->extended_id));
+        entry->key = CAN_HID_KEY(m->can_id, m->extended_id);
+        next[i] = entry->head;
+        entry->head = i;
+
+        layout[m->device_idx].configured = true;
+        layout[m->device_idx].report_id = m->report_id;
+        layout[m->device_idx].report_size = m->report_size;
+        owned[m->device_idx][m->report_byte] |= m->report_mask;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (mappings != s_mappings) {
+        memcpy(s_mappings, mappings, sizeof(s_mappings));
+        memcpy(s_in_use, in_use, sizeof(s_in_use));
+    }
+    memcpy(s_hash, hash, sizeof(s_hash));
+    memcpy(s_next, next, sizeof(s_next));
+    for (int d = 0; d < MAX_HID_DEVICES; d++) {
+        can_hid_device_report_t *report = &s_reports[d];
+        if (!layout[d].configured) {
+            // Last mapping gone: keep the old report ID and size for one final
+            // all-clear transfer. A report already waiting for it is left alone.
+            if (report->configured) {
+                memset(report->data, 0, sizeof(report->data));
+                report->configured = false;
+                report->dirty = true;
+                report->generation++;
+            }
+            continue;
+        }
+        if (!report->configured || report->report_id != layout[d].report_id ||
+            report->report_size != layout[d].report_size) {
+            // New layout starts with every bit clear and is sent once, putting the
+            // device in a known state. Bumping the generation stops an in-flight
+            // transfer of the old layout from being retried.
+            layout[d].generation = report->generation + 1;
+            layout[d].dirty = true;
+            *report = layout[d];
+            continue;
+        }
+        // Same layout: keep the current contents, minus bits nobody owns any more
+        bool cleared = false;
+        for (int b = 0; b < report->report_size; b++) {
+            if (report->data[b] & ~owned[d][b]) {
+                report->data[b] &= owned[d][b];
+                cleared = true;
+            }
+        }
+        if (cleared) {
+            report->dirty = true;
+            report->generation++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static bool validate_mapping(const can_hid_mapping_t *mapping)
+{
+    if (mapping->can_byte >= 8 || mapping->can_mask == 0 || mapping->report_mask == 0) {
+        return false;
+    }
+    if (mapping->device_idx >= MAX_HID_DEVICES) {
+        return false;
+    }
+    if (mapping->report_size == 0 || mapping->report_size > CAN_HID_MAX_REPORT_SIZE ||
+        mapping->report_byte >= mapping->report_size) {
+        return false;
+    }
+    if (mapping->extended_id ? mapping->can_id > 0x1FFFFFFF : mapping->can_id > 0x7FF) {
+        return false;
+    }
+    return true;
+}
+
+// Check that a mapping agrees with the report layout already used for its device
+// by the mappings in a list
+static bool layout_compatible(const can_hid_mapping_t *mappings, const bool *in_use,
+                              const can_hid_mapping_t *mapping)
+{
+    for (int i = 0; i < MAX_CAN_HID_MAPPINGS; i++) {
+        if (!in_use[i] || mappings[i].device_idx != mapping->device_idx) {
+            continue;
+        }
+        if (mappings[i].report_id != mapping->report_id ||
+            mappings[i].report_size != mapping->report_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t mapping_output_bits(const can_hid_mapping_t *m, const can_message_t *message)
+{
+    uint8_t source = (m->can_byte < message->dlc) ? (message->data[m->can_byte] & m->can_mask) : 0;
+
+    if (m->as_flag) {
+        bool on = (source != 0) != m->invert;
+        return on ? m->report_mask : 0;
+    }
+
+    uint8_t value = (uint8_t)((source >> lowest_bit(m->can_mask)) << lowest_bit(m->report_mask));
+    if (m->invert) {
+        value = ~value;
+    }
+    return value & m->report_mask;
+}
+
+esp_err_t can_hid_output_process_frame(const can_message_t *message)
+{
+    if (message == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (message->rtr) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    bool matched = false;
+    uint32_t key = CAN_HID_KEY(message->id, message->extended);
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.frames_received++;
+
+    can_hid_hash_entry_t *entry = hash_lookup(s_hash, key);
+    if (entry != NULL && entry->head != CAN_HID_NO_ENTRY) {
+        matched = true;
+        s_stats.frames_matched++;
+
+        for (uint8_t i = entry->head; i != CAN_HID_NO_ENTRY; i = s_next[i]) {
+            const can_hid_mapping_t *m = &s_mappings[i];
+            can_hid_device_report_t *report = &s_reports[m->device_idx];
+
+            uint8_t old_byte = report->data[m->report_byte];
+            uint8_t new_byte = (old_byte & ~m->report_mask) | mapping_output_bits(m, message);
+            if (new_byte == old_byte) {
+                continue;
+            }
+
+            report->data[m->report_byte] = new_byte;
+            if (report->dirty) {
+                s_stats.reports_coalesced++;
+            }
+            report->dirty = true;
+            report->generation++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return matched ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static void can_hid_rx_task(void *arg)
+{
+    can_message_t message;
+
+    while (s_running) {
+        if (can_receive(s_config.can_port, &message, CAN_HID_RX_TIMEOUT_MS) == ESP_OK) {
+            esp_err_t ret = can_hid_output_process_frame(&message);
+            TRACE(TRACE_CAN_RX, message.id, message.dlc, ret == ESP_OK);
+            telemetry_record_can(message.id, message.extended, message.dlc, message.data);
+        }
+    }
+
+    s_rx_task = NULL;
+    xEventGroupSetBits(s_task_events, CAN_HID_RX_EXITED_BIT);
+    vTaskDelete(NULL);
+}
+
+static void can_hid_flush_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    TickType_t period = pdMS_TO_TICKS(s_config.flush_interval_ms);
+    if (period == 0) {
+        period = 1;
+    }
+
+    while (s_running) {
+        vTaskDelayUntil(&last_wake, period);
+
+        for (int d = 0; d < MAX_HID_DEVICES; d++) {
+            uint8_t data[CAN_HID_MAX_REPORT_SIZE];
+            uint8_t report_id;
+            uint8_t report_size;
+            uint32_t generation;
+            bool send = false;
+
+            // Snapshot the pending report; the USB transfer happens outside the lock
+            portENTER_CRITICAL(&s_lock);
+            if (s_reports[d].dirty) {
+                memcpy(data, s_reports[d].data, sizeof(data));
+                report_id = s_reports[d].report_id;
+                report_size = s_reports[d].report_size;
+                generation = s_reports[d].generation;
+                send = true;
+            }
+            portEXIT_CRITICAL(&s_lock);
+
+            if (!send) {
+                continue;
+            }
+
+            // Leave the report pending while the device is absent, so it gets
+            // the latest state as soon as it (re)connects
+            hid_device_info_t info;
+            if (hid_host_get_device_info(d, &info) != ESP_OK || !info.connected) {
+                continue;
+            }
+
+            portENTER_CRITICAL(&s_lock);
+            if (s_reports[d].generation == generation) {
+                s_reports[d].dirty = false;
+            }
+            portEXIT_CRITICAL(&s_lock);
+
+            esp_err_t ret = hid_host_set_output_report(d, report_id, data, report_size);
+            TRACE(TRACE_CAN_HID_REPORT, d, report_id, report_size, ret);
+
+            portENTER_CRITICAL(&s_lock);
+            if (ret == ESP_OK) {
+                s_stats.reports_sent++;
+            } else {
+                s_stats.report_errors++;
+                // Retry next interval unless a newer update is already pending
+                if (s_reports[d].generation == generation) {
+                    s_reports[d].dirty = true;
+                }
+            }
+            portEXIT_CRITICAL(&s_lock);
+
+            if (ret == ESP_OK) {
+                boot_timeline_first_forward();
+            }
+        }
+    }
+
+    s_flush_task = NULL;
+    xEventGroupSetBits(s_task_events, CAN_HID_FLUSH_EXITED_BIT);
+    vTaskDelete(NULL);
+}
+
+esp_err_t can_hid_output_init(const can_hid_output_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    if (s_config.flush_interval_ms == 0) {
+        s_config.flush_interval_ms = CAN_HID_DEFAULT_FLUSH_INTERVAL_MS;
+    }
+
+    if (s_task_events == NULL) {
+        s_task_events = xEventGroupCreate();
+        if (s_task_events == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(s_mappings, 0, sizeof(s_mappings));
+    memset(s_in_use, 0, sizeof(s_in_use));
+    memset(s_reports, 0, sizeof(s_reports));
+    memset(&s_stats, 0, sizeof(s_stats));
+    rebuild_tables(s_mappings, s_in_use);
+
+    s_running = true;
+    if (xTaskCreate(can_hid_rx_task, "can_hid_rx", 3072, NULL,
+                    s_config.rx_task_priority, &s_rx_task) != pdPASS) {
+        s_running = false;
+        vSemaphoreDelete(s_mutex);
+        s_mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(can_hid_flush_task, "can_hid_flush", 3072, NULL,
+                    s_config.flush_task_priority, &s_flush_task) != pdPASS) {
+        s_running = false;
+        xEventGroupWaitBits(s_task_events, CAN_HID_RX_EXITED_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+        vSemaphoreDelete(s_mutex);
+        s_mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_initialized = true;
+    ESP_LOGI(TAG, "CAN to HID output initialized (port %d, flush interval %lu ms)",
+             s_config.can_port, (unsigned long)s_config.flush_interval_ms);
+    return ESP_OK;
+}
+
+esp_err_t can_hid_output_deinit(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Let both tasks finish their current iteration, and wait until they have
+    // exited before the mutex and tables can be reused
+    s_running = false;
+    xEventGroupWaitBits(s_task_events, CAN_HID_RX_EXITED_BIT | CAN_HID_FLUSH_EXITED_BIT,
+                        pdTRUE, pdTRUE, portMAX_DELAY);
+
+    vSemaphoreDelete(s_mutex);
+    s_mutex = NULL;
+    s_initialized = false;
+    return ESP_OK;
+}
+
+// Install a mapping in the first free slot. Must be called with s_mutex held;
+// the caller rebuilds the tables.
+static esp_err_t add_locked(const can_hid_mapping_t *mapping, uint16_t *mapping_idx)
+{
+    if (!layout_compatible(s_mappings, s_in_use, mapping)) {
+        ESP_LOGE(TAG, "Device %d already uses a different output report layout", mapping->device_idx);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < MAX_CAN_HID_MAPPINGS; i++) {
+        if (!s_in_use[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The receive path reads s_mappings under s_lock, so publish the new entry there too
+    portENTER_CRITICAL(&s_lock);
+    s_mappings[slot] = *mapping;
+    s_in_use[slot] = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    *mapping_idx = slot;
+    return ESP_OK;
+}
+
+esp_err_t can_hid_output_add(const can_hid_mapping_t *mapping, uint16_t *mapping_idx)
+{
+    if (mapping == NULL || mapping_idx == NULL || !validate_mapping(mapping)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_err_t ret = add_locked(mapping, mapping_idx);
+    if (ret == ESP_OK) {
+        rebuild_tables(s_mappings, s_in_use);
+    }
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t can_hid_output_remove(uint16_t mapping_idx)
+{
+    if (mapping_idx >= MAX_CAN_HID_MAPPINGS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!s_in_use[mapping_idx]) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Drop the mapping from the dispatch tables before releasing its slot
+    s_in_use[mapping_idx] = false;
+    rebuild_tables(s_mappings, s_in_use);
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+esp_err_t can_hid_output_get(uint16_t mapping_idx, can_hid_mapping_t *mapping)
+{
+    if (mapping_idx >= MAX_CAN_HID_MAPPINGS || mapping == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (s_in_use[mapping_idx]) {
+        *mapping = s_mappings[mapping_idx];
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t can_hid_output_clear(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memset(s_in_use, 0, sizeof(s_in_use));
+    rebuild_tables(s_mappings, s_in_use);
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+esp_err_t can_hid_output_get_stats(can_hid_output_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t can_hid_output_save(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    can_hid_mapping_t mappings[MAX_CAN_HID_MAPPINGS];
+    size_t count = 0;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < MAX_CAN_HID_MAPPINGS; i++) {
+        if (s_in_use[i]) {
+            mappings[count++] = s_mappings[i];
+        }
+    }
+    xSemaphoreGive(s_mutex);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(CAN_HID_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_u8(handle, CAN_HID_NVS_KEY_VERSION, CAN_HID_NVS_VERSION);
+    if (ret == ESP_OK) {
+        // A zero-length blob is valid and records an empty mapping set
+        ret = nvs_set_blob(handle, CAN_HID_NVS_KEY_MAPPINGS, mappings, count * sizeof(can_hid_mapping_t));
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Saved %u CAN to HID mappings", (unsigned)count);
+    }
+    return ret;
+}
+
+esp_err_t can_hid_output_load(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    can_hid_mapping_t mappings[MAX_CAN_HID_MAPPINGS];
+    size_t size = sizeof(mappings);
+    uint8_t version = 0;
+    nvs_handle_t handle;
+
+    esp_err_t ret = nvs_open(CAN_HID_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_get_u8(handle, CAN_HID_NVS_KEY_VERSION, &version);
+    if (ret == ESP_OK && version != CAN_HID_NVS_VERSION) {
+        ret = ESP_ERR_INVALID_VERSION;
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, CAN_HID_NVS_KEY_MAPPINGS, mappings, &size);
+    }
+    nvs_close(handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (size % sizeof(can_hid_mapping_t) != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t count = size / sizeof(can_hid_mapping_t);
+    size_t loaded = 0;
+    bool in_use[MAX_CAN_HID_MAPPINGS] = { false };
+
+    // Validate and compact in place, then swap the whole set in with one rebuild
+    for (size_t i = 0; i < count; i++) {
+        if (!validate_mapping(&mappings[i]) || !layout_compatible(mappings, in_use, &mappings[i])) {
+            ESP_LOGW(TAG, "Skipping invalid stored mapping %u", (unsigned)i);
+            continue;
+        }
+        mappings[loaded] = mappings[i];
+        in_use[loaded] = true;
+        loaded++;
+    }
+    memset(&mappings[loaded], 0, (MAX_CAN_HID_MAPPINGS - loaded) * sizeof(can_hid_mapping_t));
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    rebuild_tables(mappings, in_use);
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Loaded %u CAN to HID mappings", (unsigned)loaded);
+    return ESP_OK;
+}
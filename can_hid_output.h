@@ -0,0 +1,179 @@
+/**
+ * @file can_hid_output.h
+ * @brief CAN to HID output report mapping
+ *
+ * This file contains the declarations for the reverse path of the system:
+ * received CAN frames are mapped onto HID output reports (keyboard LEDs,
+ * gamepad rumble/LEDs) so that ECU state can be reflected on the connected
+ * input devices.
+ *
+ * Incoming frame IDs are dispatched through a precomputed hash table, and
+ * output reports are coalesced per device so that a burst of frames results
+ * in at most one USB OUT transfer per device per flush interval.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "can_bus.h"
+#include "hid_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of CAN to HID output mappings
+ */
+#define MAX_CAN_HID_MAPPINGS 32
+
+/**
+ * @brief Maximum size of a coalesced HID output report in bytes
+ */
+#define CAN_HID_MAX_REPORT_SIZE 8
+
+/**
+ * @brief Default interval between USB OUT transfers to the same device (ms)
+ */
+#define CAN_HID_DEFAULT_FLUSH_INTERVAL_MS 20
+
+/**
+ * @brief CAN to HID output mapping structure
+ *
+ * The selected bits of the CAN payload (`can_byte` / `can_mask`) are
+ * normalised to a boolean or shifted value and written into the selected
+ * bits of the device output report (`report_byte` / `report_mask`).
+ */
+typedef struct {
+    bool enabled;                    /*!< Mapping enabled flag */
+    uint32_t can_id;                 /*!< CAN message ID to match */
+    bool extended_id;                /*!< Match extended (29-bit) ID */
+    uint8_t can_byte;                /*!< Source byte in the CAN payload (0-7) */
+    uint8_t can_mask;                /*!< Source bit mask within the byte */
+    bool invert;                     /*!< Invert the source value */
+    bool as_flag;                    /*!< Treat any set source bit as "on" (sets all report_mask bits) */
+    uint8_t device_idx;              /*!< Target HID device index */
+    uint8_t report_id;               /*!< Target HID output report ID */
+    uint8_t report_size;             /*!< Target output report size in bytes (1-CAN_HID_MAX_REPORT_SIZE) */
+    uint8_t report_byte;             /*!< Target byte in the output report */
+    uint8_t report_mask;             /*!< Target bit mask within the byte */
+} can_hid_mapping_t;
+
+/**
+ * @brief CAN to HID output configuration structure
+ */
+typedef struct {
+    uint8_t can_port;                /*!< CAN port to receive frames from */
+    uint32_t flush_interval_ms;      /*!< Minimum interval between output reports per device (ms) */
+    uint8_t rx_task_priority;        /*!< Priority of the CAN receive/dispatch task */
+    uint8_t flush_task_priority;     /*!< Priority of the USB output flush task */
+} can_hid_output_config_t;
+
+/**
+ * @brief CAN to HID output statistics
+ */
+typedef struct {
+    uint32_t frames_received;        /*!< CAN frames received */
+    uint32_t frames_matched;         /*!< CAN frames that matched at least one mapping */
+    uint32_t reports_sent;           /*!< HID output reports sent */
+    uint32_t reports_coalesced;      /*!< Report updates merged into a pending transfer */
+    uint32_t report_errors;          /*!< HID output report transfer failures */
+} can_hid_output_stats_t;
+
+/**
+ * @brief Initialize the CAN to HID output system
+ *
+ * Starts the CAN receive/dispatch task and the USB output flush task.
+ *
+ * @param config Pointer to the configuration
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_init(const can_hid_output_config_t *config);
+
+/**
+ * @brief Deinitialize the CAN to HID output system
+ *
+ * Stops the receive and flush tasks and blocks until both have exited, which
+ * takes up to one receive timeout or flush interval.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_deinit(void);
+
+/**
+ * @brief Add a new CAN to HID output mapping
+ *
+ * All mappings targeting the same device must use the same report ID and size.
+ *
+ * @param mapping Pointer to the mapping configuration
+ * @param[out] mapping_idx Pointer to store the mapping index
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_add(const can_hid_mapping_t *mapping, uint16_t *mapping_idx);
+
+/**
+ * @brief Remove a CAN to HID output mapping
+ *
+ * @param mapping_idx Mapping index
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_remove(uint16_t mapping_idx);
+
+/**
+ * @brief Get a CAN to HID output mapping
+ *
+ * @param mapping_idx Mapping index
+ * @param[out] mapping Pointer to store the mapping configuration
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_get(uint16_t mapping_idx, can_hid_mapping_t *mapping);
+
+/**
+ * @brief Remove all CAN to HID output mappings
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_clear(void);
+
+/**
+ * @brief Process a received CAN frame
+ *
+ * Updates the pending output report of every device targeted by a mapping
+ * for this frame ID. No USB transfer is performed from this call; reports
+ * are sent by the flush task. Called by the internal receive task, and may
+ * also be called directly for frames received elsewhere.
+ *
+ * @param message Pointer to the received CAN message
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no mapping matched
+ */
+esp_err_t can_hid_output_process_frame(const can_message_t *message);
+
+/**
+ * @brief Save the CAN to HID output mappings to non-volatile storage
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_save(void);
+
+/**
+ * @brief Load the CAN to HID output mappings from non-volatile storage
+ *
+ * Replaces the current mappings. Stored entries that fail validation are skipped.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if nothing was saved yet
+ */
+esp_err_t can_hid_output_load(void);
+
+/**
+ * @brief Get CAN to HID output statistics
+ *
+ * @param[out] stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t can_hid_output_get_stats(can_hid_output_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -153,6 +153,18 @@ esp_err_t mapping_add(const input_mapping_t *mapping, uint16_t *mapping_idx);
  */
 esp_err_t mapping_update(uint16_t mapping_idx, const input_mapping_t *mapping);
 
+/**
+ * @brief Replace all input-output mappings in a single step
+ *
+ * The new set is installed under the mapping lock, so event processing sees
+ * either the old or the new set, never a mix.
+ *
+ * @param mappings Pointer to the new mappings
+ * @param count Number of mappings
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t mapping_replace_all(const input_mapping_t *mappings, uint16_t count);
+
 /**
  * @brief Remove an input-output mapping
  * 
@@ -166,7 +178,7 @@ esp_err_t mapping_remove(uint16_t mapping_idx);
  * 
  * @param mapping_idx Mapping index
  * @param[out] mapping Pointer to store the mapping configuration
- * @return esp_err_t ESP_OK on success, error code otherwise
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the slot is empty, error code otherwise
  */
 esp_err_t mapping_get(uint16_t mapping_idx, input_mapping_t *mapping);
 
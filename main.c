@@ -13,17 +13,28 @@ This file serves as the main entry point for the ESP32-S3 HID to Serial/CAN syst
 #include "esp_netif.h"
 #include "esp_event.h"
 #include "esp_spiffs.h"
+#include "freertos/event_groups.h"
 
 #include "hid_host.h"
 #include "input_mapping.h"
 #include "serial_port.h"
 #include "can_bus.h"
+#include "can_hid_output.h"
 #include "web_server.h"
+#include "telemetry.h"
 #include "firmware_update.h"
 #include "tunerstudio.h"
+#include "tunerstudio_realtime.h"
+#include "boot_timeline.h"
+#include "trace.h"
+#include "mem_arena.h"
 
 static const char *TAG = "main";
 
+// Set to 1 to log decoded trace records on the console. Records logged there are
+// no longer in the rings, so leave it off when collecting dumps from /api/trace/dump.
+#define TRACE_LOG_TO_CONSOLE 0
+
 // Initialize SPIFFS for storing web files and configuration
 static esp_err_t init_spiffs(void)
 {
@@ -83,7 +94,11 @@ static esp_err_t init_wifi_ap(void)
     esp_netif_create_default_wifi_ap();
     
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    esp_err_t ret = esp_wifi_init(&cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize WiFi (%s)", esp_err_to_name(ret));
+        return ret;
+    }
     
     wifi_config_t wifi_config = {
         .ap = {
@@ -95,39 +110,120 @@ static esp_err_t init_wifi_ap(void)
         },
     };
     
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    ret = esp_wifi_set_mode(WIFI_MODE_AP);
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_config(WIFI_IF_AP, &wifi_config);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_wifi_start();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start WiFi AP (%s)", esp_err_to_name(ret));
+        return ret;
+    }
     
     ESP_LOGI(TAG, "WiFi AP started with SSID: %s", "ESP32-HID-Config");
     return ESP_OK;
 }
 
+// Record a deferred service step; failures are logged but never abort boot
+static esp_err_t boot_service_step(const char *name, esp_err_t ret)
+{
+    boot_timeline_mark(name, ret);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Boot stage %s failed (%s), continuing without it", name, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// Event bits set by the deferred service tasks
+#define BOOT_BIT_SPIFFS_DONE  BIT0
+#define BOOT_BIT_STORAGE_DONE BIT1
+#define BOOT_BIT_NETWORK_DONE BIT2
+#define BOOT_BITS_DEFERRED    (BOOT_BIT_STORAGE_DONE | BOOT_BIT_NETWORK_DONE)
+
+static EventGroupHandle_t s_boot_events = NULL;
+static bool s_spiffs_mounted = false;
+
+// Stage 2a: mount SPIFFS (may format on first boot) and start TunerStudio, which reads its INI from it
+static void boot_storage_task(void *arg)
+{
+    s_spiffs_mounted = boot_service_step("spiffs", init_spiffs()) == ESP_OK;
+    xEventGroupSetBits(s_boot_events, BOOT_BIT_SPIFFS_DONE);
+    
+    tunerstudio_config_t ts_config = {
+        .protocol = TUNERSTUDIO_PROTOCOL_MS2,
+        .serial_port = 0,
+        .baud_rate = 115200,
+        .signature = "ESP32S3HID",
+        .ini_path = "/spiffs/tunerstudio.ini",
+        .enabled = true
+    };
+    if (boot_service_step("tunerstudio_init", tunerstudio_init(&ts_config)) == ESP_OK) {
+        boot_service_step("tunerstudio_start", tunerstudio_start());
+    }
+    
+    xEventGroupSetBits(s_boot_events, BOOT_BIT_STORAGE_DONE);
+    vTaskDelete(NULL);
+}
+
+// Stage 2b: bring up networking, firmware update and the web server
+static void boot_network_task(void *arg)
+{
+    esp_err_t ret = esp_netif_init();
+    if (ret == ESP_OK) {
+        ret = esp_event_loop_create_default();
+    }
+    if (boot_service_step("netif", ret) == ESP_OK) {
+        boot_service_step("wifi_ap", init_wifi_ap());
+    }
+    
+    firmware_update_config_t update_config = {
+        .progress_cb = NULL,
+        .auto_reboot = true,
+        .reboot_delay_ms = 5000
+    };
+    boot_service_step("firmware_update", firmware_update_init(&update_config));
+    
+    // The web server serves its assets from SPIFFS
+    xEventGroupWaitBits(s_boot_events, BOOT_BIT_SPIFFS_DONE, pdFALSE, pdTRUE, portMAX_DELAY);
+    if (!s_spiffs_mounted) {
+        ESP_LOGW(TAG, "Starting web server without SPIFFS; static files will be unavailable");
+    }
+    if (boot_service_step("web_server_init", web_server_init()) == ESP_OK) {
+        boot_service_step("web_server_start", web_server_start());
+    }
+    
+    xEventGroupSetBits(s_boot_events, BOOT_BIT_NETWORK_DONE);
+    vTaskDelete(NULL);
+}
+
 // Main application task
 void app_main(void)
 {
     // Initialize system components
     ESP_LOGI(TAG, "ESP32-S3 HID to Serial/CAN System starting...");
+    boot_timeline_mark("app_main", ESP_OK);
     
-    // Initialize NVS
-    ESP_ERROR_CHECK(init_nvs());
-    
-    // Initialize SPIFFS
-    ESP_ERROR_CHECK(init_spiffs());
+    // Reserve the internal and PSRAM arenas before any component allocates from them.
+    // Without PSRAM only the bulk features (telemetry, OTA streaming, JSON import) are lost.
+    if (mem_arena_init() != ESP_OK) {
+        ESP_LOGW(TAG, "PSRAM arena unavailable, continuing with forwarding only");
+    }
     
-    // Initialize TCP/IP and event loop
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    // Initialize binary tracing first so every component can use it; hot-path
+    // categories are switched on at runtime with trace_set_categories()
+    ESP_ERROR_CHECK(trace_init(TRACE_CAT_SYSTEM));
+#if TRACE_LOG_TO_CONSOLE
+    ESP_ERROR_CHECK(trace_start_log_task(1, 100));
+#endif
     
-    // Initialize WiFi in AP mode
-    ESP_ERROR_CHECK(init_wifi_ap());
+    // Stage 1: everything needed to forward HID input to CAN/serial outputs.
+    // These are required, so failures still abort.
     
-    // Initialize HID host
-    hid_host_config_t hid_config = {
-        .callback = hid_host_event_callback,
-        .max_devices = 4
-    };
-    ESP_ERROR_CHECK(hid_host_init(&hid_config));
+    // Initialize NVS
+    ESP_ERROR_CHECK(init_nvs());
+    boot_timeline_mark("nvs", ESP_OK);
     
     // Initialize serial ports
     for (int i = 0; i < 3; i++) {
@@ -141,6 +237,7 @@ void app_main(void)
         };
         ESP_ERROR_CHECK(serial_port_init(&serial_config));
     }
+    boot_timeline_mark("serial", ESP_OK);
     
     // Initialize CAN bus
     can_bus_config_t can_config = {
@@ -149,59 +246,104 @@ void app_main(void)
         .bitrate = CAN_BITRATE_500K
     };
     ESP_ERROR_CHECK(can_bus_init(&can_config));
+    boot_timeline_mark("can", ESP_OK);
+    
+    // Initialize the realtime snapshot published by the mapping task
+    ESP_ERROR_CHECK(ts_realtime_init());
     
     // Initialize input mapping
     ESP_ERROR_CHECK(input_mapping_init());
     
     // Load mappings from NVS
     ESP_ERROR_CHECK(input_mapping_load());
+    boot_timeline_mark("mappings", ESP_OK);
     
-    // Initialize firmware update
-    firmware_update_config_t update_config = {
-        .progress_cb = NULL,
-        .auto_reboot = true,
-        .reboot_delay_ms = 5000
+    // Initialize live telemetry (streamed on /ws/telemetry, below the real-time path).
+    // It is diagnostic only, so a failure is logged and forwarding starts without it.
+    telemetry_config_t telemetry_config = {
+        .tick_ms = TELEMETRY_DEFAULT_TICK_MS,
+        .task_priority = 2
     };
-    ESP_ERROR_CHECK(firmware_update_init(&update_config));
+    boot_service_step("telemetry", telemetry_init(&telemetry_config));
     
-    // Initialize TunerStudio
-    tunerstudio_config_t ts_config = {
-        .protocol = TUNERSTUDIO_PROTOCOL_MS2,
-        .serial_port = 0,
-        .baud_rate = 115200,
-        .signature = "ESP32S3HID",
-        .ini_path = "/spiffs/tunerstudio.ini",
-        .enabled = true
+    // Initialize HID host last, so the first report finds its mappings and outputs ready
+    hid_host_config_t hid_config = {
+        .callback = hid_host_event_callback,
+        .max_devices = 4
     };
-    ESP_ERROR_CHECK(tunerstudio_init(&ts_config));
+    ESP_ERROR_CHECK(hid_host_init(&hid_config));
+    boot_timeline_mark("usb_host", ESP_OK);
     
-    // Start TunerStudio service
-    ESP_ERROR_CHECK(tunerstudio_start());
+    // Initialize CAN to HID output reports (keyboard LEDs, gamepad rumble)
+    can_hid_output_config_t can_hid_config = {
+        .can_port = 0,
+        .flush_interval_ms = CAN_HID_DEFAULT_FLUSH_INTERVAL_MS,
+        .rx_task_priority = 5,
+        .flush_task_priority = 4
+    };
+    ESP_ERROR_CHECK(can_hid_output_init(&can_hid_config));
+    esp_err_t can_hid_ret = can_hid_output_load();
+    if (can_hid_ret != ESP_OK && can_hid_ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Failed to load CAN to HID mappings (%s)", esp_err_to_name(can_hid_ret));
+    }
+    boot_timeline_mark("outputs_live", ESP_OK);
     
-    // Initialize and start web server
-    ESP_ERROR_CHECK(web_server_init());
-    ESP_ERROR_CHECK(web_server_start());
+    ESP_LOGI(TAG, "Forwarding path ready, starting deferred services");
     
-    ESP_LOGI(TAG, "System initialization complete");
+    // Stage 2: storage and network services come up in parallel at low priority.
+    // Failures here are logged and recorded in the boot timeline only.
+    s_boot_events = xEventGroupCreate();
+    if (s_boot_events == NULL) {
+        ESP_LOGE(TAG, "Failed to create boot event group, deferred services not started");
+    } else {
+        if (xTaskCreate(boot_storage_task, "boot_storage", 4096, NULL, 2, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create storage boot task");
+            xEventGroupSetBits(s_boot_events, BOOT_BIT_SPIFFS_DONE | BOOT_BIT_STORAGE_DONE);
+        }
+        if (xTaskCreate(boot_network_task, "boot_network", 4096, NULL, 2, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create network boot task");
+            xEventGroupSetBits(s_boot_events, BOOT_BIT_NETWORK_DONE);
+        }
+    }
     
     // Main loop
+    bool deferred_logged = (s_boot_events == NULL);
+    bool forward_logged = false;
     while (1) {
-        // System is now running with all components initialized
-        // Main processing is done in respective component tasks
+        // Main processing is done in respective component tasks.
+        // Log the boot timeline once the deferred services are up, and again with
+        // arena usage once the first frame has been forwarded (which may never
+        // happen if no device is plugged in).
+        if (!deferred_logged &&
+            (xEventGroupGetBits(s_boot_events) & BOOT_BITS_DEFERRED) == BOOT_BITS_DEFERRED) {
+            ESP_LOGI(TAG, "Deferred services finished");
+            boot_timeline_log();
+            deferred_logged = true;
+        }
+        if (!forward_logged && boot_timeline_forwarding()) {
+            boot_timeline_log();
+            mem_arena_log_stats();
+            forward_logged = true;
+        }
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 ```
 
-This main application file initializes all the components of the ESP32-S3 HID to Serial/CAN system and starts the necessary services. The system operates as follows:
+This main application file initializes all the components of the ESP32-S3 HID to Serial/CAN system and starts the necessary services. Boot is split into stages so HID-to-CAN/serial forwarding does not wait for the slow services:
+
+1. Stage 1 (required, aborts on failure):
+   1. Reserve the memory arenas (internal RAM for hot state, PSRAM for bulk buffers; a missing PSRAM only disables the bulk features), then initialize tracing and NVS
+   2. Initialize the output interfaces (Serial, CAN)
+   3. Set up the input mapping system and load mappings from NVS
+   4. Initialize live telemetry (optional: a failure is logged and boot continues)
+   5. Initialize the USB HID host and the CAN to HID output path
+2. Stage 2 (deferred, runs in parallel low-priority tasks; failures are logged and skipped):
+   1. Mount SPIFFS, then set up TunerStudio integration
+   2. Set up WiFi in Access Point mode and initialize the firmware update mechanism
+   3. Start the web server once SPIFFS is mounted
+3. Enter the main loop
 
-1. Initialize storage (NVS and SPIFFS)
-2. Set up WiFi in Access Point mode
-3. Initialize all hardware interfaces (HID, Serial, CAN)
-4. Set up the input mapping system
-5. Initialize firmware update mechanism
-6. Set up TunerStudio integration
-7. Start the web server
-8. Enter the main loop
+Each stage is recorded with `boot_timeline_mark()`. The main loop logs the timeline once both deferred tasks have finished, and again when the first frame is forwarded, so that time is reported even though it depends on when a device is plugged in. Only the CAN to HID output path records it so far: its flush task calls `boot_timeline_first_forward()` when the first output report reaches a device. The HID to serial/CAN mapping path does not call it yet, so the metric is not produced for that direction. The timeline is also available at any time through `boot_timeline_get()`.
 
 Each component runs in its own task, handling its specific functionality while the main task monitors the overall system status.
@@ -0,0 +1,914 @@
+/**
+ * @file mapping_json.c
+ * @brief Streaming JSON import/export of mapping sets implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef MAPPING_JSON_HOST
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#endif
+
+#include "mapping_json.h"
+#include "mem_arena.h"
+
+#ifndef MAPPING_JSON_HOST
+static const char *TAG = "mapping_json";
+#endif
+
+typedef enum {
+    LEX_NONE = 0,
+    LEX_STRING,
+    LEX_STRING_ESC,
+    LEX_STRING_UNICODE,
+    LEX_NUMBER,
+    LEX_LITERAL
+} lex_state_t;
+
+typedef enum {
+    TOK_BEGIN_OBJECT,
+    TOK_END_OBJECT,
+    TOK_BEGIN_ARRAY,
+    TOK_END_ARRAY,
+    TOK_COLON,
+    TOK_COMMA,
+    TOK_STRING,
+    TOK_NUMBER,
+    TOK_LITERAL
+} token_t;
+
+typedef enum {
+    SCOPE_ROOT = 0,                  // Top-level array of mappings
+    SCOPE_MAPPING,
+    SCOPE_CONDITION,
+    SCOPE_SERIAL,
+    SCOPE_CANBUS,
+    SCOPE_OUTPUT_DATA,
+    SCOPE_SKIP                       // Value of an unknown key
+} scope_t;
+
+typedef enum {
+    ST_KEY_OR_END = 0,               // Object: after '{'
+    ST_KEY,                          // Object: after ','
+    ST_COLON,
+    ST_VALUE_OR_END,                 // Array: after '['
+    ST_VALUE,
+    ST_COMMA_OR_END
+} frame_state_t;
+
+typedef enum {
+    KIND_BOOL,
+    KIND_INT,
+    KIND_STRING,
+    KIND_OBJECT,
+    KIND_ARRAY
+} value_kind_t;
+
+typedef enum {
+    F_UNKNOWN = 0,
+    F_ENABLED,
+    F_DEVICE_IDX,
+    F_INPUT_TYPE,
+    F_INPUT_INDEX,
+    F_CONDITION,
+    F_OUTPUT_TYPE,
+    F_SERIAL,
+    F_CANBUS,
+    F_OUTPUT_FORMAT,
+    F_FORMAT_STRING,
+    F_CAN_ID,
+    F_CAN_DLC,
+    F_OUTPUT_DATA,
+    F_SCALE_FACTOR,
+    F_OFFSET,
+    F_MIN_INTERVAL,
+    F_COND_TYPE,
+    F_COND_VALUE,
+    F_SER_PORT,
+    F_SER_BAUD,
+    F_SER_DATA_BITS,
+    F_SER_STOP_BITS,
+    F_SER_PARITY,
+    F_SER_FLOW,
+    F_CAN_PORT,
+    F_CAN_BITRATE,
+    F_CAN_EXTENDED,
+    F_COUNT
+} field_t;
+
+_Static_assert(F_COUNT <= 32, "seen_fields holds one bit per field");
+
+typedef struct {
+    uint8_t scope;
+    const char *name;
+    uint8_t field;
+    uint8_t kind;
+    int64_t min;
+    int64_t max;
+} field_desc_t;
+
+static const field_desc_t s_fields[] = {
+    { SCOPE_MAPPING,   "enabled",         F_ENABLED,       KIND_BOOL,   0, 1 },
+    { SCOPE_MAPPING,   "device_idx",      F_DEVICE_IDX,    KIND_INT,    0, MAX_HID_DEVICES - 1 },
+    { SCOPE_MAPPING,   "input_type",      F_INPUT_TYPE,    KIND_INT,    INPUT_TYPE_KEYBOARD_KEY, INPUT_TYPE_GENERIC_REPORT },
+    { SCOPE_MAPPING,   "input_index",     F_INPUT_INDEX,   KIND_INT,    0, UINT8_MAX },
+    { SCOPE_MAPPING,   "condition",       F_CONDITION,     KIND_OBJECT, 0, 0 },
+    { SCOPE_MAPPING,   "output_type",     F_OUTPUT_TYPE,   KIND_INT,    OUTPUT_TYPE_SERIAL, OUTPUT_TYPE_CANBUS },
+    { SCOPE_MAPPING,   "serial",          F_SERIAL,        KIND_OBJECT, 0, 0 },
+    { SCOPE_MAPPING,   "canbus",          F_CANBUS,        KIND_OBJECT, 0, 0 },
+    { SCOPE_MAPPING,   "output_format",   F_OUTPUT_FORMAT, KIND_INT,    FORMAT_RAW, FORMAT_CUSTOM },
+    { SCOPE_MAPPING,   "format_string",   F_FORMAT_STRING, KIND_STRING, 0, 0 },
+    { SCOPE_MAPPING,   "can_id",          F_CAN_ID,        KIND_INT,    0, 0x1FFFFFFF },
+    { SCOPE_MAPPING,   "can_dlc",         F_CAN_DLC,       KIND_INT,    0, 8 },
+    { SCOPE_MAPPING,   "output_data",     F_OUTPUT_DATA,   KIND_ARRAY,  0, 0 },
+    { SCOPE_MAPPING,   "scale_factor",    F_SCALE_FACTOR,  KIND_INT,    INT32_MIN, INT32_MAX },
+    { SCOPE_MAPPING,   "offset",          F_OFFSET,        KIND_INT,    INT32_MIN, INT32_MAX },
+    { SCOPE_MAPPING,   "min_interval_ms", F_MIN_INTERVAL,  KIND_INT,    0, UINT32_MAX },
+    { SCOPE_CONDITION, "type",            F_COND_TYPE,     KIND_INT,    CONDITION_EQUALS, CONDITION_ALWAYS },
+    { SCOPE_CONDITION, "value",           F_COND_VALUE,    KIND_INT,    INT32_MIN, INT32_MAX },
+    { SCOPE_SERIAL,    "port",            F_SER_PORT,      KIND_INT,    0, 2 },
+    { SCOPE_SERIAL,    "baud_rate",       F_SER_BAUD,      KIND_INT,    300, 5000000 },
+    { SCOPE_SERIAL,    "data_bits",       F_SER_DATA_BITS, KIND_INT,    5, 8 },
+    { SCOPE_SERIAL,    "stop_bits",       F_SER_STOP_BITS, KIND_INT,    1, 2 },
+    { SCOPE_SERIAL,    "parity",          F_SER_PARITY,    KIND_INT,    0, 2 },
+    { SCOPE_SERIAL,    "flow_control",    F_SER_FLOW,      KIND_INT,    0, 2 },
+    { SCOPE_CANBUS,    "port",            F_CAN_PORT,      KIND_INT,    0, 1 },
+    { SCOPE_CANBUS,    "bitrate",         F_CAN_BITRATE,   KIND_INT,    10000, 1000000 },
+    { SCOPE_CANBUS,    "extended_id",     F_CAN_EXTENDED,  KIND_BOOL,   0, 1 },
+};
+
+// Fields every mapping must specify
+#define REQUIRED_FIELDS ((1u << F_DEVICE_IDX) | (1u << F_INPUT_TYPE) | (1u << F_OUTPUT_TYPE))
+
+static esp_err_t fail(mapping_json_import_t *ctx, const char *message)
+{
+    if (ctx->error == NULL) {
+        ctx->error = message;
+        ctx->error_offset = ctx->offset;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+static const field_desc_t *find_field(uint8_t scope, const char *name)
+{
+    for (size_t i = 0; i < sizeof(s_fields) / sizeof(s_fields[0]); i++) {
+        if (s_fields[i].scope == scope && strcmp(s_fields[i].name, name) == 0) {
+            return &s_fields[i];
+        }
+    }
+    return NULL;
+}
+
+static const field_desc_t *field_desc(uint8_t field)
+{
+    for (size_t i = 0; i < sizeof(s_fields) / sizeof(s_fields[0]); i++) {
+        if (s_fields[i].field == field) {
+            return &s_fields[i];
+        }
+    }
+    return NULL;
+}
+
+// Strict JSON integer: -?(0|[1-9][0-9]*)
+static bool parse_int(const char *text, int64_t *value)
+{
+    const char *p = text;
+    bool negative = false;
+    int64_t result = 0;
+
+    if (*p == '-') {
+        negative = true;
+        p++;
+    }
+    if (*p == '\0' || (*p == '0' && p[1] != '\0')) {
+        return false;
+    }
+    for (int digits = 0; *p != '\0'; p++, digits++) {
+        if (*p < '0' || *p > '9' || digits >= 12) {
+            return false;
+        }
+        result = result * 10 + (*p - '0');
+    }
+
+    *value = negative ? -result : result;
+    return true;
+}
+
+static void mapping_defaults(input_mapping_t *m)
+{
+    memset(m, 0, sizeof(*m));
+    m->enabled = true;
+    m->condition.type = CONDITION_ALWAYS;
+    m->scale_factor = 100;           // 1.00 in fixed point
+}
+
+// The serial and canbus settings share a union, so their defaults can only be
+// filled in once the mapping is complete and output_type is known
+static esp_err_t apply_output_defaults(mapping_json_import_t *ctx, input_mapping_t *m)
+{
+    uint32_t seen = ctx->seen_fields;
+
+    if (m->output_type == OUTPUT_TYPE_CANBUS) {
+        if (seen & (1u << F_SERIAL)) {
+            return fail(ctx, "serial object on a CAN bus mapping");
+        }
+        if (!(seen & (1u << F_CAN_BITRATE))) {
+            m->output_config.canbus.bitrate = 500000;
+        }
+    } else {
+        if (seen & (1u << F_CANBUS)) {
+            return fail(ctx, "canbus object on a serial mapping");
+        }
+        if (!(seen & (1u << F_SER_BAUD))) {
+            m->output_config.serial.baud_rate = 115200;
+        }
+        if (!(seen & (1u << F_SER_DATA_BITS))) {
+            m->output_config.serial.data_bits = 8;
+        }
+        if (!(seen & (1u << F_SER_STOP_BITS))) {
+            m->output_config.serial.stop_bits = 1;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t validate_mapping(mapping_json_import_t *ctx, const input_mapping_t *m)
+{
+    if ((ctx->seen_fields & REQUIRED_FIELDS) != REQUIRED_FIELDS) {
+        return fail(ctx, "mapping requires device_idx, input_type and output_type");
+    }
+    if (m->output_type == OUTPUT_TYPE_CANBUS) {
+        if (!m->output_config.canbus.extended_id && m->can_id > 0x7FF) {
+            return fail(ctx, "can_id exceeds 11 bits without extended_id");
+        }
+        if (m->output_data_len > m->can_dlc && m->output_format == FORMAT_RAW) {
+            return fail(ctx, "output_data longer than can_dlc");
+        }
+    }
+    if (m->output_format == FORMAT_CUSTOM && m->format_string[0] == '\0') {
+        return fail(ctx, "custom output_format requires format_string");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t assign_scalar(mapping_json_import_t *ctx, uint8_t field, token_t tok)
+{
+    input_mapping_t *m = &ctx->staging[ctx->count];
+    const field_desc_t *desc = field_desc(field);
+    int64_t v = 0;
+
+    switch (desc->kind) {
+    case KIND_BOOL:
+        if (tok != TOK_LITERAL || (strcmp(ctx->token, "true") != 0 && strcmp(ctx->token, "false") != 0)) {
+            return fail(ctx, "boolean expected");
+        }
+        v = ctx->token[0] == 't';
+        break;
+    case KIND_INT:
+        if (tok != TOK_NUMBER || !parse_int(ctx->token, &v)) {
+            return fail(ctx, "integer expected");
+        }
+        if (v < desc->min || v > desc->max) {
+            return fail(ctx, "value out of range");
+        }
+        break;
+    case KIND_STRING:
+        if (tok != TOK_STRING) {
+            return fail(ctx, "string expected");
+        }
+        break;
+    default:
+        return fail(ctx, "object or array expected");
+    }
+
+    switch (field) {
+    case F_ENABLED:       m->enabled = v; break;
+    case F_DEVICE_IDX:    m->device_idx = v; break;
+    case F_INPUT_TYPE:    m->input_type = (input_type_t)v; break;
+    case F_INPUT_INDEX:   m->input_index = v; break;
+    case F_OUTPUT_TYPE:   m->output_type = (output_type_t)v; break;
+    case F_OUTPUT_FORMAT: m->output_format = (output_format_t)v; break;
+    case F_CAN_ID:        m->can_id = v; break;
+    case F_CAN_DLC:       m->can_dlc = v; break;
+    case F_SCALE_FACTOR:  m->scale_factor = v; break;
+    case F_OFFSET:        m->offset = v; break;
+    case F_MIN_INTERVAL:  m->min_interval_ms = v; break;
+    case F_COND_TYPE:     m->condition.type = (condition_type_t)v; break;
+    case F_COND_VALUE:    m->condition.value = v; break;
+    case F_SER_PORT:      m->output_config.serial.port = v; break;
+    case F_SER_BAUD:      m->output_config.serial.baud_rate = v; break;
+    case F_SER_DATA_BITS: m->output_config.serial.data_bits = v; break;
+    case F_SER_STOP_BITS: m->output_config.serial.stop_bits = v; break;
+    case F_SER_PARITY:    m->output_config.serial.parity = v; break;
+    case F_SER_FLOW:      m->output_config.serial.flow_control = v; break;
+    case F_CAN_PORT:      m->output_config.canbus.port = v; break;
+    case F_CAN_BITRATE:   m->output_config.canbus.bitrate = v; break;
+    case F_CAN_EXTENDED:  m->output_config.canbus.extended_id = v; break;
+    case F_FORMAT_STRING:
+        if (ctx->token_len >= sizeof(m->format_string)) {
+            return fail(ctx, "format_string too long");
+        }
+        memcpy(m->format_string, ctx->token, ctx->token_len + 1);
+        break;
+    default:
+        break;
+    }
+
+    ctx->seen_fields |= 1u << field;
+    return ESP_OK;
+}
+
+static esp_err_t push(mapping_json_import_t *ctx, uint8_t scope, bool is_array)
+{
+    if (ctx->depth >= MAPPING_JSON_MAX_DEPTH) {
+        return fail(ctx, "nesting too deep");
+    }
+    mapping_json_frame_t *frame = &ctx->stack[ctx->depth++];
+    frame->scope = scope;
+    frame->state = is_array ? ST_VALUE_OR_END : ST_KEY_OR_END;
+    frame->key = F_UNKNOWN;
+    frame->count = 0;
+    return ESP_OK;
+}
+
+static bool frame_is_array(const mapping_json_frame_t *frame)
+{
+    return frame->scope == SCOPE_ROOT || frame->scope == SCOPE_OUTPUT_DATA ||
+           (frame->scope == SCOPE_SKIP && frame->key == 1);
+}
+
+// A value token (scalar or container start) in an array element or object member position
+static esp_err_t handle_value(mapping_json_import_t *ctx, mapping_json_frame_t *frame, token_t tok)
+{
+    bool container = (tok == TOK_BEGIN_OBJECT || tok == TOK_BEGIN_ARRAY);
+    frame->state = ST_COMMA_OR_END;
+
+    switch (frame->scope) {
+    case SCOPE_ROOT:
+        if (tok != TOK_BEGIN_OBJECT) {
+            return fail(ctx, "mapping object expected");
+        }
+        if (ctx->count >= ctx->capacity) {
+            fail(ctx, "too many mappings");
+            return ESP_ERR_NO_MEM;
+        }
+        mapping_defaults(&ctx->staging[ctx->count]);
+        ctx->seen_fields = 0;
+        return push(ctx, SCOPE_MAPPING, false);
+
+    case SCOPE_OUTPUT_DATA: {
+        input_mapping_t *m = &ctx->staging[ctx->count];
+        int64_t v;
+        if (tok != TOK_NUMBER || !parse_int(ctx->token, &v) || v < 0 || v > UINT8_MAX) {
+            return fail(ctx, "output_data elements must be 0-255");
+        }
+        if (frame->count >= sizeof(m->output_data)) {
+            return fail(ctx, "output_data longer than 8 bytes");
+        }
+        m->output_data[frame->count++] = v;
+        m->output_data_len = frame->count;
+        return ESP_OK;
+    }
+
+    case SCOPE_SKIP:
+        break;
+
+    default:
+        // Member of a mapping or one of its nested objects
+        if (frame->key == F_UNKNOWN) {
+            break;
+        }
+        switch (frame->key) {
+        case F_CONDITION:
+        case F_SERIAL:
+        case F_CANBUS:
+            if (tok != TOK_BEGIN_OBJECT) {
+                return fail(ctx, "object expected");
+            }
+            ctx->seen_fields |= 1u << frame->key;
+            return push(ctx, frame->key == F_CONDITION ? SCOPE_CONDITION :
+                             frame->key == F_SERIAL ? SCOPE_SERIAL : SCOPE_CANBUS, false);
+        case F_OUTPUT_DATA:
+            if (tok != TOK_BEGIN_ARRAY) {
+                return fail(ctx, "array expected");
+            }
+            ctx->seen_fields |= 1u << F_OUTPUT_DATA;
+            ctx->staging[ctx->count].output_data_len = 0;
+            return push(ctx, SCOPE_OUTPUT_DATA, true);
+        default:
+            if (container) {
+                return fail(ctx, "scalar expected");
+            }
+            return assign_scalar(ctx, frame->key, tok);
+        }
+    }
+
+    // Ignored value: descend into containers so their contents are skipped too
+    if (container) {
+        esp_err_t ret = push(ctx, SCOPE_SKIP, tok == TOK_BEGIN_ARRAY);
+        if (ret == ESP_OK) {
+            // Skip frames use key to remember whether they are arrays
+            ctx->stack[ctx->depth - 1].key = (tok == TOK_BEGIN_ARRAY);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t handle_close(mapping_json_import_t *ctx, mapping_json_frame_t *frame)
+{
+    ctx->depth--;
+
+    if (frame->scope == SCOPE_MAPPING) {
+        esp_err_t ret = apply_output_defaults(ctx, &ctx->staging[ctx->count]);
+        if (ret == ESP_OK) {
+            ret = validate_mapping(ctx, &ctx->staging[ctx->count]);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        ctx->count++;
+    } else if (frame->scope == SCOPE_ROOT) {
+        ctx->done = true;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t handle_token(mapping_json_import_t *ctx, token_t tok)
+{
+    if (ctx->done) {
+        return fail(ctx, "data after end of document");
+    }
+    if (ctx->depth == 0) {
+        if (tok != TOK_BEGIN_ARRAY) {
+            return fail(ctx, "array of mappings expected");
+        }
+        return push(ctx, SCOPE_ROOT, true);
+    }
+
+    mapping_json_frame_t *frame = &ctx->stack[ctx->depth - 1];
+    bool is_array = frame_is_array(frame);
+
+    switch (frame->state) {
+    case ST_KEY_OR_END:
+    case ST_KEY:
+        if (tok == TOK_END_OBJECT && frame->state == ST_KEY_OR_END) {
+            return handle_close(ctx, frame);
+        }
+        if (tok != TOK_STRING) {
+            return fail(ctx, "key expected");
+        }
+        if (frame->scope != SCOPE_SKIP) {
+            // A key longer than any field name is unknown, so it is skipped rather than rejected
+            const field_desc_t *desc = ctx->token_overflow ? NULL : find_field(frame->scope, ctx->token);
+            frame->key = desc ? desc->field : F_UNKNOWN;
+        }
+        frame->state = ST_COLON;
+        return ESP_OK;
+
+    case ST_COLON:
+        if (tok != TOK_COLON) {
+            return fail(ctx, "':' expected");
+        }
+        frame->state = ST_VALUE;
+        return ESP_OK;
+
+    case ST_VALUE_OR_END:
+        if (tok == TOK_END_ARRAY) {
+            return handle_close(ctx, frame);
+        }
+        // Fall through
+    case ST_VALUE:
+        if (tok == TOK_END_OBJECT || tok == TOK_END_ARRAY || tok == TOK_COLON || tok == TOK_COMMA) {
+            return fail(ctx, "value expected");
+        }
+        return handle_value(ctx, frame, tok);
+
+    case ST_COMMA_OR_END:
+        if (tok == TOK_COMMA) {
+            frame->state = is_array ? ST_VALUE : ST_KEY;
+            return ESP_OK;
+        }
+        if (tok == (is_array ? TOK_END_ARRAY : TOK_END_OBJECT)) {
+            return handle_close(ctx, frame);
+        }
+        return fail(ctx, is_array ? "',' or ']' expected" : "',' or '}' expected");
+    }
+
+    return fail(ctx, "internal parser error");
+}
+
+// Characters past MAPPING_JSON_MAX_TOKEN are dropped and flagged; whoever consumes the token decides
+static void token_append(mapping_json_import_t *ctx, char c)
+{
+    if (ctx->token_len >= MAPPING_JSON_MAX_TOKEN) {
+        ctx->token_overflow = true;
+        return;
+    }
+    ctx->token[ctx->token_len++] = c;
+    ctx->token[ctx->token_len] = '\0';
+}
+
+// Append a unicode escape (\uXXXX) as UTF-8
+static esp_err_t token_append_unicode(mapping_json_import_t *ctx, uint16_t cp)
+{
+    if (cp == 0) {
+        return fail(ctx, "NUL in string");
+    }
+    if (cp >= 0xD800 && cp <= 0xDFFF) {
+        return fail(ctx, "surrogate escapes not supported");
+    }
+    if (cp < 0x80) {
+        token_append(ctx, cp);
+    } else if (cp < 0x800) {
+        token_append(ctx, 0xC0 | (cp >> 6));
+        token_append(ctx, 0x80 | (cp & 0x3F));
+    } else {
+        token_append(ctx, 0xE0 | (cp >> 12));
+        token_append(ctx, 0x80 | ((cp >> 6) & 0x3F));
+        token_append(ctx, 0x80 | (cp & 0x3F));
+    }
+    return ESP_OK;
+}
+
+esp_err_t mapping_json_import_begin(mapping_json_import_t *ctx, input_mapping_t *staging, uint16_t capacity)
+{
+    if (ctx == NULL || staging == NULL || capacity == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->staging = staging;
+    ctx->capacity = capacity;
+    ctx->lex_state = LEX_NONE;
+    return ESP_OK;
+}
+
+esp_err_t mapping_json_import_feed(mapping_json_import_t *ctx, const char *data, size_t len)
+{
+    if (ctx == NULL || (data == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ctx->error != NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t i = 0;
+
+    while (i < len && ret == ESP_OK) {
+        char c = data[i];
+
+        switch (ctx->lex_state) {
+        case LEX_STRING:
+            if (c == '\\') {
+                ctx->lex_state = LEX_STRING_ESC;
+            } else if (c == '"') {
+                ctx->lex_state = LEX_NONE;
+                ret = handle_token(ctx, TOK_STRING);
+            } else if ((unsigned char)c < 0x20) {
+                ret = fail(ctx, "control character in string");
+            } else {
+                token_append(ctx, c);
+            }
+            break;
+
+        case LEX_STRING_ESC: {
+            static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+            const char *e = NULL;
+            for (const char *p = escapes; *p != '\0'; p += 2) {
+                if (*p == c) {
+                    e = p;
+                    break;
+                }
+            }
+            if (c == 'u') {
+                ctx->lex_state = LEX_STRING_UNICODE;
+                ctx->unicode = 0;
+                ctx->unicode_digits = 0;
+            } else if (e == NULL) {
+                ret = fail(ctx, "unsupported escape sequence");
+            } else {
+                ctx->lex_state = LEX_STRING;
+                token_append(ctx, e[1]);
+            }
+            break;
+        }
+
+        case LEX_STRING_UNICODE: {
+            int digit = (c >= '0' && c <= '9') ? c - '0' :
+                        (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                        (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit < 0) {
+                ret = fail(ctx, "invalid \\u escape");
+                break;
+            }
+            ctx->unicode = (ctx->unicode << 4) | digit;
+            if (++ctx->unicode_digits == 4) {
+                ctx->lex_state = LEX_STRING;
+                ret = token_append_unicode(ctx, ctx->unicode);
+            }
+            break;
+        }
+
+        case LEX_NUMBER:
+        case LEX_LITERAL:
+            if ((ctx->lex_state == LEX_NUMBER && ((c >= '0' && c <= '9') || c == '-' || c == '+' ||
+                                                  c == '.' || c == 'e' || c == 'E')) ||
+                (ctx->lex_state == LEX_LITERAL && c >= 'a' && c <= 'z')) {
+                token_append(ctx, c);
+                break;
+            }
+            // Token ended; the current character is processed again as a new token
+            if (ctx->token_overflow) {
+                ret = fail(ctx, "token too long");
+            } else {
+                ret = handle_token(ctx, ctx->lex_state == LEX_NUMBER ? TOK_NUMBER : TOK_LITERAL);
+            }
+            ctx->lex_state = LEX_NONE;
+            continue;
+
+        case LEX_NONE:
+        default:
+            ctx->token_len = 0;
+            ctx->token[0] = '\0';
+            ctx->token_overflow = false;
+            switch (c) {
+            case ' ': case '\t': case '\r': case '\n':
+                break;
+            case '{': ret = handle_token(ctx, TOK_BEGIN_OBJECT); break;
+            case '}': ret = handle_token(ctx, TOK_END_OBJECT); break;
+            case '[': ret = handle_token(ctx, TOK_BEGIN_ARRAY); break;
+            case ']': ret = handle_token(ctx, TOK_END_ARRAY); break;
+            case ':': ret = handle_token(ctx, TOK_COLON); break;
+            case ',': ret = handle_token(ctx, TOK_COMMA); break;
+            case '"':
+                ctx->lex_state = LEX_STRING;
+                break;
+            default:
+                if (c == '-' || (c >= '0' && c <= '9')) {
+                    ctx->lex_state = LEX_NUMBER;
+                    token_append(ctx, c);
+                } else if (c >= 'a' && c <= 'z') {
+                    ctx->lex_state = LEX_LITERAL;
+                    token_append(ctx, c);
+                } else {
+                    ret = fail(ctx, "unexpected character");
+                }
+                break;
+            }
+            break;
+        }
+
+        i++;
+        ctx->offset++;
+    }
+
+    return ret;
+}
+
+esp_err_t mapping_json_import_commit(mapping_json_import_t *ctx)
+{
+    if (ctx == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ctx->error != NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ctx->done || ctx->lex_state != LEX_NONE) {
+        fail(ctx, ctx->done ? "data after end of document" : "unexpected end of document");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return mapping_replace_all(ctx->staging, ctx->count);
+}
+
+esp_err_t mapping_json_export_begin(mapping_json_export_t *ctx)
+{
+    if (ctx == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    return ESP_OK;
+}
+
+// Write a JSON string literal, escaping as needed
+static int write_json_string(char *buf, size_t size, const char *str)
+{
+    size_t n = 0;
+
+    if (size < 3) {
+        return -1;
+    }
+    buf[n++] = '"';
+    for (const char *p = str; *p != '\0'; p++) {
+        unsigned char c = *p;
+        if (n + 7 >= size) {
+            return -1;
+        }
+        if (c == '"' || c == '\\') {
+            buf[n++] = '\\';
+            buf[n++] = c;
+        } else if (c < 0x20) {
+            static const char short_escapes[] = "\bb\ff\nn\rr\tt";
+            const char *e = strchr(short_escapes, c);
+            if (e != NULL && ((e - short_escapes) & 1) == 0) {
+                buf[n++] = '\\';
+                buf[n++] = e[1];
+            } else {
+                n += snprintf(&buf[n], size - n, "\\u%04x", c);
+            }
+        } else {
+            buf[n++] = c;
+        }
+    }
+    buf[n++] = '"';
+    buf[n] = '\0';
+    return n;
+}
+
+static int serialize_mapping(const input_mapping_t *m, char *buf, size_t size)
+{
+    int n = snprintf(buf, size,
+                     "{\"enabled\":%s,\"device_idx\":%u,\"input_type\":%d,\"input_index\":%u,"
+                     "\"condition\":{\"type\":%d,\"value\":%ld},\"output_type\":%d,",
+                     m->enabled ? "true" : "false", m->device_idx, m->input_type, m->input_index,
+                     m->condition.type, (long)m->condition.value, m->output_type);
+
+    if (m->output_type == OUTPUT_TYPE_CANBUS) {
+        n += snprintf(buf + n, size - n, "\"canbus\":{\"port\":%u,\"bitrate\":%lu,\"extended_id\":%s},",
+                      m->output_config.canbus.port, (unsigned long)m->output_config.canbus.bitrate,
+                      m->output_config.canbus.extended_id ? "true" : "false");
+    } else {
+        n += snprintf(buf + n, size - n,
+                      "\"serial\":{\"port\":%u,\"baud_rate\":%lu,\"data_bits\":%u,\"stop_bits\":%u,"
+                      "\"parity\":%u,\"flow_control\":%u},",
+                      m->output_config.serial.port, (unsigned long)m->output_config.serial.baud_rate,
+                      m->output_config.serial.data_bits, m->output_config.serial.stop_bits,
+                      m->output_config.serial.parity, m->output_config.serial.flow_control);
+    }
+
+    n += snprintf(buf + n, size - n, "\"output_format\":%d,\"format_string\":", m->output_format);
+    int s = write_json_string(buf + n, size - n, m->format_string);
+    if (s < 0) {
+        return -1;
+    }
+    n += s;
+
+    n += snprintf(buf + n, size - n, ",\"can_id\":%lu,\"can_dlc\":%u,\"output_data\":[",
+                  (unsigned long)m->can_id, m->can_dlc);
+    for (uint8_t i = 0; i < m->output_data_len && i < sizeof(m->output_data); i++) {
+        n += snprintf(buf + n, size - n, i ? ",%u" : "%u", m->output_data[i]);
+    }
+    n += snprintf(buf + n, size - n, "],\"scale_factor\":%ld,\"offset\":%ld,\"min_interval_ms\":%lu}",
+                  (long)m->scale_factor, (long)m->offset, (unsigned long)m->min_interval_ms);
+
+    return n < (int)size ? n : -1;
+}
+
+esp_err_t mapping_json_export_next(mapping_json_export_t *ctx, char *buf, size_t size, size_t *len)
+{
+    if (ctx == NULL || buf == NULL || len == NULL || size < MAPPING_JSON_EXPORT_CHUNK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *len = 0;
+    if (ctx->finished) {
+        return ESP_OK;
+    }
+
+    size_t n = 0;
+    if (!ctx->started) {
+        buf[n++] = '[';
+        ctx->started = true;
+    }
+
+    // Slots freed by deletes leave holes, so skip to the next occupied one
+    input_mapping_t mapping;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    while (ctx->next < MAPPING_JSON_MAX_MAPPINGS && ret == ESP_ERR_NOT_FOUND) {
+        ret = mapping_get(ctx->next++, &mapping);
+    }
+
+    if (ret == ESP_OK) {
+        if (ctx->emitted > 0) {
+            buf[n++] = ',';
+        }
+        int written = serialize_mapping(&mapping, buf + n, size - n);
+        if (written < 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        n += written;
+        ctx->emitted++;
+    } else if (ret == ESP_ERR_NOT_FOUND) {
+        buf[n++] = ']';
+        ctx->finished = true;
+    } else {
+        return ret;
+    }
+
+    *len = n;
+    return ESP_OK;
+}
+
+#ifndef MAPPING_JSON_HOST
+esp_err_t mapping_json_http_import(httpd_req_t *req)
+{
+    // The HTTP server handles one request at a time
+    static mapping_json_import_t s_import;
+    input_mapping_t *staging = NULL;
+    size_t mark;
+    char buf[MAPPING_JSON_RECV_CHUNK];
+    char resp[128];
+
+    int64_t start = esp_timer_get_time();
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    heap_caps_monitor_local_minimum_free_size_start();
+
+    // Staging array comes from the PSRAM arena for the duration of the request
+    if (mem_arena_scratch_begin(MEM_ARENA_BULK, &mark) == ESP_OK) {
+        staging = mem_arena_alloc(MEM_ARENA_BULK, MAPPING_JSON_MAX_MAPPINGS * sizeof(input_mapping_t), TAG);
+        if (staging == NULL) {
+            mem_arena_scratch_end(MEM_ARENA_BULK, mark);
+        }
+    }
+    if (staging == NULL) {
+        heap_caps_monitor_local_minimum_free_size_stop();
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    mapping_json_import_begin(&s_import, staging, MAPPING_JSON_MAX_MAPPINGS);
+
+    esp_err_t ret = ESP_OK;
+    size_t remaining = req->content_len;
+    while (remaining > 0 && ret == ESP_OK) {
+        int received = httpd_req_recv(req, buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (received <= 0) {
+            ret = ESP_FAIL;
+            break;
+        }
+        ret = mapping_json_import_feed(&s_import, buf, received);
+        remaining -= received;
+    }
+    if (ret == ESP_OK) {
+        ret = mapping_json_import_commit(&s_import);
+    }
+    mem_arena_scratch_end(MEM_ARENA_BULK, mark);
+
+    size_t min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    heap_caps_monitor_local_minimum_free_size_stop();
+    ESP_LOGI(TAG, "Import of %u mappings (%u bytes) took %lld us, peak internal heap use %u bytes",
+             s_import.count, (unsigned)req->content_len, (long long)(esp_timer_get_time() - start),
+             (unsigned)(free_before > min_free ? free_before - min_free : 0));
+
+    if (ret != ESP_OK) {
+        snprintf(resp, sizeof(resp), "Mapping import failed at byte %u: %s",
+                 (unsigned)s_import.error_offset, s_import.error ? s_import.error : esp_err_to_name(ret));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, resp);
+        return ret;
+    }
+
+    snprintf(resp, sizeof(resp), "{\"status\":\"ok\",\"count\":%u}", s_import.count);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t mapping_json_http_export(httpd_req_t *req)
+{
+    mapping_json_export_t ctx;
+    char buf[MAPPING_JSON_EXPORT_CHUNK];
+    size_t len;
+
+    esp_err_t ret = mapping_json_export_begin(&ctx);
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read mappings");
+        return ret;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    do {
+        ret = mapping_json_export_next(&ctx, buf, sizeof(buf), &len);
+        if (ret != ESP_OK) {
+            // Headers are already sent; terminate the chunked response
+            httpd_resp_send_chunk(req, NULL, 0);
+            return ret;
+        }
+        if (len > 0) {
+            ret = httpd_resp_send_chunk(req, buf, len);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
+    } while (len > 0);
+
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
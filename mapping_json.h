@@ -0,0 +1,191 @@
+/**
+ * @file mapping_json.h
+ * @brief Streaming JSON import/export of mapping sets
+ *
+ * This file contains the declarations for bulk import and export of
+ * input-output mappings without building a JSON tree. The importer is an
+ * incremental (SAX-style) parser fed with arbitrary pieces of the request
+ * body; it decodes straight into input_mapping_t records in a caller-provided
+ * staging array, validates each field as it arrives, and installs the whole
+ * set with mapping_replace_all() only if the complete document is valid.
+ * The exporter serialises one mapping at a time into a small buffer so the
+ * response can be sent in chunks.
+ *
+ * Document format: a JSON array of mapping objects, e.g.
+ *
+ *   [{"enabled":true,"device_idx":0,"input_type":0,"input_index":4,
+ *     "condition":{"type":0,"value":1},"output_type":1,
+ *     "canbus":{"port":0,"bitrate":500000,"extended_id":false},
+ *     "output_format":0,"format_string":"","can_id":256,"can_dlc":2,
+ *     "output_data":[1,2],"scale_factor":100,"offset":0,"min_interval_ms":10}]
+ *
+ * Enumerations are encoded as their integer values. Unknown keys are ignored.
+ * A mapping carries the "serial" or the "canbus" object matching its
+ * output_type, never the other one; settings it leaves out get the usual
+ * defaults (115200 8N1, 500 kbit/s).
+ *
+ * Building with MAPPING_JSON_HOST defined leaves out the HTTP handlers, for
+ * benchmarking the importer on a development machine (tools/mapping_bench.c).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "hid_host.h"
+#include "input_mapping.h"
+
+#ifndef MAPPING_JSON_HOST
+#include "esp_http_server.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of mappings in one document (all devices)
+ */
+#define MAPPING_JSON_MAX_MAPPINGS (MAX_MAPPINGS_PER_DEVICE * MAX_HID_DEVICES)
+
+/**
+ * @brief Maximum JSON nesting depth
+ */
+#define MAPPING_JSON_MAX_DEPTH 6
+
+/**
+ * @brief Maximum length of a string or number token
+ *
+ * Longer keys are treated as unknown and skipped; longer values are rejected.
+ */
+#define MAPPING_JSON_MAX_TOKEN 40
+
+/**
+ * @brief Size of the export buffer that always fits one serialised mapping
+ */
+#define MAPPING_JSON_EXPORT_CHUNK 512
+
+/**
+ * @brief Size of the request body pieces read from the socket and fed to the importer
+ */
+#define MAPPING_JSON_RECV_CHUNK 512
+
+/**
+ * @brief Parser context entry (internal use)
+ */
+typedef struct {
+    uint8_t scope;                   /*!< What the container holds */
+    uint8_t state;                   /*!< What the parser expects next */
+    uint8_t key;                     /*!< Field of the pending value */
+    uint8_t count;                   /*!< Elements seen (arrays) */
+} mapping_json_frame_t;
+
+/**
+ * @brief Streaming import context
+ */
+typedef struct {
+    input_mapping_t *staging;                          /*!< Staging array (caller-provided) */
+    uint16_t capacity;                                 /*!< Staging array capacity */
+    uint16_t count;                                    /*!< Mappings decoded so far */
+    size_t offset;                                     /*!< Bytes consumed, for error reporting */
+    bool done;                                         /*!< Top-level array closed */
+    uint32_t seen_fields;                              /*!< Fields present in the current mapping */
+    const char *error;                                 /*!< Error message, NULL if none */
+    size_t error_offset;                               /*!< Byte offset of the error */
+    uint8_t depth;                                     /*!< Current nesting depth */
+    mapping_json_frame_t stack[MAPPING_JSON_MAX_DEPTH];/*!< Container stack */
+    uint8_t lex_state;                                 /*!< Tokenizer state (internal use) */
+    bool token_overflow;                               /*!< Pending token exceeded MAPPING_JSON_MAX_TOKEN */
+    uint8_t unicode_digits;                            /*!< Hex digits read of a unicode escape */
+    uint16_t unicode;                                  /*!< Code point of a unicode escape */
+    uint8_t token_len;                                 /*!< Pending token length */
+    char token[MAPPING_JSON_MAX_TOKEN + 1];            /*!< Pending token text */
+} mapping_json_import_t;
+
+/**
+ * @brief Streaming export context
+ */
+typedef struct {
+    uint16_t next;                   /*!< Next mapping slot to look at */
+    uint16_t emitted;                /*!< Mappings serialised so far */
+    bool started;                    /*!< Opening bracket emitted */
+    bool finished;                   /*!< Closing bracket emitted */
+} mapping_json_export_t;
+
+/**
+ * @brief Begin a streaming import
+ *
+ * @param ctx Pointer to the import context
+ * @param staging Staging array for decoded mappings
+ * @param capacity Number of entries in the staging array
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t mapping_json_import_begin(mapping_json_import_t *ctx, input_mapping_t *staging, uint16_t capacity);
+
+/**
+ * @brief Feed a piece of the JSON document to the importer
+ *
+ * @param ctx Pointer to the import context
+ * @param data Pointer to the data
+ * @param len Length of the data in bytes
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on a syntax or
+ *                   validation error (see ctx->error), ESP_ERR_NO_MEM if the
+ *                   document holds more mappings than the staging array
+ */
+esp_err_t mapping_json_import_feed(mapping_json_import_t *ctx, const char *data, size_t len);
+
+/**
+ * @brief Finish the import and install the decoded mappings
+ *
+ * Nothing is changed unless the whole document was parsed and validated.
+ *
+ * @param ctx Pointer to the import context
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the document is incomplete
+ */
+esp_err_t mapping_json_import_commit(mapping_json_import_t *ctx);
+
+/**
+ * @brief Begin a streaming export of the current mappings
+ *
+ * The export walks all MAPPING_JSON_MAX_MAPPINGS slots and skips empty ones,
+ * so deleted mappings in the middle of the table are not a problem.
+ *
+ * @param ctx Pointer to the export context
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t mapping_json_export_begin(mapping_json_export_t *ctx);
+
+/**
+ * @brief Produce the next piece of the exported document
+ *
+ * @param ctx Pointer to the export context
+ * @param[out] buf Buffer to store the piece (at least MAPPING_JSON_EXPORT_CHUNK bytes)
+ * @param size Size of the buffer
+ * @param[out] len Pointer to store the piece length (0 when the export is complete)
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t mapping_json_export_next(mapping_json_export_t *ctx, char *buf, size_t size, size_t *len);
+
+#ifndef MAPPING_JSON_HOST
+/**
+ * @brief Handle a bulk import request body (`POST /api/mappings` with an array body)
+ *
+ * @param req HTTP request
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t mapping_json_http_import(httpd_req_t *req);
+
+/**
+ * @brief Handle `GET /api/mappings` with a chunked streaming response
+ *
+ * @param req HTTP request
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t mapping_json_http_export(httpd_req_t *req);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,288 @@
+/**
+ * @file mem_arena.c
+ * @brief Fixed-budget memory arenas implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mem_arena.h"
+
+#ifdef MEM_ARENA_HOST
+#include <stdlib.h>
+
+#define ESP_LOGI(tag, fmt, ...) printf("I (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ARENA_LOCK() ((void)0)
+#define ARENA_UNLOCK() ((void)0)
+typedef void *arena_task_t;
+#define current_task() ((arena_task_t)NULL)
+#else
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+#define ARENA_LOCK() portENTER_CRITICAL(&s_lock)
+#define ARENA_UNLOCK() portEXIT_CRITICAL(&s_lock)
+typedef TaskHandle_t arena_task_t;
+#define current_task() xTaskGetCurrentTaskHandle()
+#endif
+
+static const char *TAG = "mem_arena";
+
+typedef struct {
+    arena_task_t task;               // Task with open scratch scopes on the arena
+    uint8_t depth;                   // Scopes it has open, 0 if the slot is free
+} scratch_scope_t;
+
+typedef struct {
+    size_t offset;
+    arena_task_t task;               // Task whose scope the block belongs to
+    uint8_t depth;                   // Scope depth it was allocated at, 0 if the slot is free
+} scratch_block_t;
+
+// Persistent allocations grow up from the base and scratch blocks grow down from
+// the end, so a scope held across network I/O never blocks another task
+typedef struct {
+    const char *name;
+    bool external;
+    uint8_t *base;
+    size_t capacity;
+    size_t used;                     // Persistent bytes, from the base up
+    size_t scratch_floor;            // Lowest scratch block offset (capacity if none)
+    size_t high_water;
+    uint32_t allocations;
+    uint32_t failures;
+    scratch_scope_t scopes[MEM_ARENA_MAX_SCRATCH_TASKS];
+    scratch_block_t blocks[MEM_ARENA_MAX_SCRATCH_BLOCKS];
+} mem_arena_t;
+
+// Internal SRAM pool; plain .bss is internal on the ESP32-S3
+static uint8_t s_hot_pool[MEM_ARENA_HOT_SIZE] __attribute__((aligned(MEM_ARENA_ALIGNMENT)));
+
+#ifdef MEM_ARENA_HOST
+static uint8_t s_bulk_pool[MEM_ARENA_BULK_SIZE] __attribute__((aligned(MEM_ARENA_ALIGNMENT)));
+#endif
+
+static mem_arena_t s_arenas[MEM_ARENA_COUNT] = {
+    [MEM_ARENA_HOT] = { .name = "hot", .external = false, .capacity = MEM_ARENA_HOT_SIZE,
+                        .scratch_floor = MEM_ARENA_HOT_SIZE },
+    [MEM_ARENA_BULK] = { .name = "bulk", .external = true, .capacity = MEM_ARENA_BULK_SIZE,
+                         .scratch_floor = MEM_ARENA_BULK_SIZE },
+};
+
+// Called with the arena locked
+static scratch_scope_t *find_scope(mem_arena_t *arena, arena_task_t task)
+{
+    for (int i = 0; i < MEM_ARENA_MAX_SCRATCH_TASKS; i++) {
+        if (arena->scopes[i].depth > 0 && arena->scopes[i].task == task) {
+            return &arena->scopes[i];
+        }
+    }
+    return NULL;
+}
+
+// Called with the arena locked
+static size_t in_use(const mem_arena_t *arena)
+{
+    return arena->used + (arena->capacity - arena->scratch_floor);
+}
+
+esp_err_t mem_arena_init(void)
+{
+    if (s_arenas[MEM_ARENA_HOT].base != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_arenas[MEM_ARENA_HOT].base = s_hot_pool;
+#ifdef MEM_ARENA_HOST
+    s_arenas[MEM_ARENA_BULK].base = s_bulk_pool;
+#else
+    // Claimed once at boot and never freed, so the PSRAM budget is fixed like the internal one
+    s_arenas[MEM_ARENA_BULK].base = heap_caps_aligned_alloc(MEM_ARENA_ALIGNMENT, MEM_ARENA_BULK_SIZE,
+                                                            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (s_arenas[MEM_ARENA_BULK].base == NULL) {
+        // Keep the hot arena so the forwarding path still boots; bulk users fail their own init
+        ESP_LOGW(TAG, "Failed to reserve %u bytes of PSRAM (is CONFIG_SPIRAM enabled?), bulk arena disabled",
+                 (unsigned)MEM_ARENA_BULK_SIZE);
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+
+    ESP_LOGI(TAG, "Arenas ready: hot %u bytes (internal), bulk %u bytes (PSRAM)",
+             (unsigned)MEM_ARENA_HOT_SIZE, (unsigned)MEM_ARENA_BULK_SIZE);
+    return ESP_OK;
+}
+
+void *mem_arena_alloc(mem_arena_class_t cls, size_t size, const char *owner)
+{
+    if (cls >= MEM_ARENA_COUNT || size == 0) {
+        return NULL;
+    }
+
+    mem_arena_t *arena = &s_arenas[cls];
+    size_t aligned = (size + MEM_ARENA_ALIGNMENT - 1) & ~(size_t)(MEM_ARENA_ALIGNMENT - 1);
+    arena_task_t task = current_task();
+    uint8_t *ptr = NULL;
+    const char *reason = NULL;
+    size_t free_bytes;
+
+    ARENA_LOCK();
+    scratch_scope_t *scope = find_scope(arena, task);
+    scratch_block_t *block = NULL;
+    if (scope != NULL) {
+        for (int i = 0; i < MEM_ARENA_MAX_SCRATCH_BLOCKS && block == NULL; i++) {
+            if (arena->blocks[i].depth == 0) {
+                block = &arena->blocks[i];
+            }
+        }
+    }
+
+    if (arena->base == NULL) {
+        reason = "arena unavailable";
+    } else if (scope != NULL && block == NULL) {
+        reason = "too many scratch blocks";
+    } else if (aligned > arena->scratch_floor - arena->used) {
+        reason = "over budget";
+    } else if (scope != NULL) {
+        // Released when the task closes the scope, see mem_arena_scratch_end()
+        arena->scratch_floor -= aligned;
+        block->offset = arena->scratch_floor;
+        block->task = task;
+        block->depth = scope->depth;
+        ptr = arena->base + arena->scratch_floor;
+    } else {
+        ptr = arena->base + arena->used;
+        arena->used += aligned;
+    }
+    if (ptr != NULL) {
+        if (in_use(arena) > arena->high_water) {
+            arena->high_water = in_use(arena);
+        }
+        arena->allocations++;
+    } else {
+        arena->failures++;
+    }
+    free_bytes = arena->scratch_floor - arena->used;
+    ARENA_UNLOCK();
+
+    if (ptr == NULL) {
+        ESP_LOGE(TAG, "%s: %u bytes from %s arena refused (%s, %u bytes free)",
+                 owner ? owner : "?", (unsigned)size, arena->name, reason, (unsigned)free_bytes);
+#ifdef MEM_ARENA_HOST
+        fflush(NULL);
+        abort();
+#endif
+        return NULL;
+    }
+
+    memset(ptr, 0, aligned);
+    return ptr;
+}
+
+esp_err_t mem_arena_scratch_begin(mem_arena_class_t cls, size_t *mark)
+{
+    if (cls >= MEM_ARENA_COUNT || mark == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mem_arena_t *arena = &s_arenas[cls];
+    arena_task_t task = current_task();
+    esp_err_t ret = ESP_OK;
+
+    ARENA_LOCK();
+    scratch_scope_t *scope = find_scope(arena, task);
+    for (int i = 0; i < MEM_ARENA_MAX_SCRATCH_TASKS && scope == NULL; i++) {
+        if (arena->scopes[i].depth == 0) {
+            scope = &arena->scopes[i];
+            scope->task = task;
+        }
+    }
+
+    if (arena->base == NULL) {
+        ret = ESP_ERR_NO_MEM;
+    } else if (scope == NULL || scope->depth == UINT8_MAX) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        // The mark is the depth to return to; blocks allocated above it belong to this scope
+        *mark = scope->depth++;
+    }
+    ARENA_UNLOCK();
+
+    return ret;
+}
+
+void mem_arena_scratch_end(mem_arena_class_t cls, size_t mark)
+{
+    if (cls >= MEM_ARENA_COUNT) {
+        return;
+    }
+
+    mem_arena_t *arena = &s_arenas[cls];
+    arena_task_t task = current_task();
+
+    ARENA_LOCK();
+    scratch_scope_t *scope = find_scope(arena, task);
+    if (scope != NULL && mark < scope->depth) {
+        scope->depth = (uint8_t)mark;
+
+        // Free the task's blocks from the closed scopes; space under another
+        // task's block is reclaimed once that block is freed as well
+        arena->scratch_floor = arena->capacity;
+        for (int i = 0; i < MEM_ARENA_MAX_SCRATCH_BLOCKS; i++) {
+            scratch_block_t *block = &arena->blocks[i];
+            if (block->depth > mark && block->task == task) {
+                block->depth = 0;
+            } else if (block->depth > 0 && block->offset < arena->scratch_floor) {
+                arena->scratch_floor = block->offset;
+            }
+        }
+    }
+    ARENA_UNLOCK();
+}
+
+bool mem_arena_available(mem_arena_class_t cls)
+{
+    return cls < MEM_ARENA_COUNT && s_arenas[cls].base != NULL;
+}
+
+esp_err_t mem_arena_get_stats(mem_arena_class_t cls, mem_arena_stats_t *stats)
+{
+    if (cls >= MEM_ARENA_COUNT || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const mem_arena_t *arena = &s_arenas[cls];
+
+    ARENA_LOCK();
+    stats->name = arena->name;
+    stats->external = arena->external;
+    stats->capacity = arena->capacity;
+    stats->used = in_use(arena);
+    stats->high_water = arena->high_water;
+    stats->allocations = arena->allocations;
+    stats->failures = arena->failures;
+    ARENA_UNLOCK();
+
+    return ESP_OK;
+}
+
+void mem_arena_log_stats(void)
+{
+    for (int cls = 0; cls < MEM_ARENA_COUNT; cls++) {
+        mem_arena_stats_t stats;
+        mem_arena_get_stats(cls, &stats);
+        if (!mem_arena_available(cls)) {
+            ESP_LOGI(TAG, "%-4s (%s): unavailable", stats.name, stats.external ? "PSRAM" : "internal");
+            continue;
+        }
+        ESP_LOGI(TAG, "%-4s (%s): used %u / %u bytes, high water %u (%u%%), %lu allocations, %lu refused",
+                 stats.name, stats.external ? "PSRAM" : "internal", (unsigned)stats.used,
+                 (unsigned)stats.capacity, (unsigned)stats.high_water,
+                 (unsigned)(stats.high_water * 100 / stats.capacity),
+                 (unsigned long)stats.allocations, (unsigned long)stats.failures);
+    }
+}
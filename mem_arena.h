@@ -0,0 +1,158 @@
+/**
+ * @file mem_arena.h
+ * @brief Fixed-budget memory arenas with explicit placement classes
+ *
+ * This file contains the declarations for the arenas that decide where
+ * component buffers live. Each placement class is one fixed-size arena:
+ *
+ * - MEM_ARENA_HOT: internal SRAM. State touched on every input event or from
+ *   IRAM code: event rings, trace rings, mapping tables, per-device state.
+ *   Internal SRAM stays accessible while the flash cache is disabled.
+ * - MEM_ARENA_BULK: octal PSRAM. Large buffers on throughput or cold paths:
+ *   telemetry frames, OTA chunks, JSON staging, web assets, capture logs.
+ *
+ * Allocation is a bump pointer and there is no free. Components allocate
+ * their persistent buffers during initialization. Buffers that are only
+ * needed during one request are taken inside a scratch scope, which returns
+ * the space when it ends; the high-water mark records the peak. Scratch
+ * buffers are taken from the end of the arena and belong to the task that
+ * opened the scope, so a scope held for a long upload blocks neither
+ * persistent allocations nor the scopes of other tasks.
+ *
+ * Building with MEM_ARENA_HOST defined keeps both arenas in ordinary static
+ * storage with the same budgets and aborts on any allocation that does not
+ * fit, so host harnesses fail where the firmware would run out of memory.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Internal SRAM arena budget in bytes
+ */
+#define MEM_ARENA_HOT_SIZE (32 * 1024)
+
+/**
+ * @brief PSRAM arena budget in bytes
+ */
+#define MEM_ARENA_BULK_SIZE (128 * 1024)
+
+/**
+ * @brief Alignment of every allocation (one PSRAM cache burst)
+ */
+#define MEM_ARENA_ALIGNMENT 16
+
+/**
+ * @brief Maximum number of tasks with scratch scopes open on one arena at a time
+ */
+#define MEM_ARENA_MAX_SCRATCH_TASKS 4
+
+/**
+ * @brief Maximum number of scratch buffers allocated from one arena at a time
+ */
+#define MEM_ARENA_MAX_SCRATCH_BLOCKS 8
+
+/**
+ * @brief Placement classes
+ */
+typedef enum {
+    MEM_ARENA_HOT = 0,               /*!< Internal SRAM, latency-critical state */
+    MEM_ARENA_BULK,                  /*!< PSRAM, bulk and cold buffers */
+    MEM_ARENA_COUNT
+} mem_arena_class_t;
+
+/**
+ * @brief Arena usage statistics
+ */
+typedef struct {
+    const char *name;                /*!< Arena name */
+    bool external;                   /*!< Arena is in PSRAM */
+    size_t capacity;                 /*!< Budget in bytes */
+    size_t used;                     /*!< Bytes currently allocated, persistent and scratch */
+    size_t high_water;               /*!< Highest usage seen, including scratch scopes */
+    uint32_t allocations;            /*!< Successful allocations */
+    uint32_t failures;               /*!< Allocations refused (over budget or too many scratch buffers) */
+} mem_arena_stats_t;
+
+/**
+ * @brief Initialize the arenas
+ *
+ * Must run before any component that allocates from an arena. If PSRAM
+ * cannot be reserved the hot arena is still set up and the bulk arena
+ * refuses every request, so only the components that need bulk buffers
+ * (telemetry, OTA streaming, JSON import) fail to start.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the bulk arena is unavailable
+ */
+esp_err_t mem_arena_init(void);
+
+/**
+ * @brief Allocate zeroed memory from an arena
+ *
+ * Outside a scratch scope the memory is never returned. Inside a scratch
+ * scope of the calling task the memory is returned when that scope closes;
+ * scopes of other tasks do not affect the call.
+ *
+ * @param cls Placement class
+ * @param size Size in bytes
+ * @param owner Name of the requesting component, for diagnostics
+ * @return void* Pointer to the memory, NULL if the request does not fit
+ */
+void *mem_arena_alloc(mem_arena_class_t cls, size_t size, const char *owner);
+
+/**
+ * @brief Open a scratch scope on an arena
+ *
+ * Scopes nest and must be closed in reverse order by the task that opened
+ * them. Each task's scopes are independent, so they may stay open across
+ * blocking I/O. Space freed under another task's open scratch buffer is
+ * reused once that buffer is released too.
+ *
+ * @param cls Placement class
+ * @param[out] mark Pointer to store the mark passed to mem_arena_scratch_end()
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the arena is unavailable,
+ *                   ESP_ERR_INVALID_STATE if MEM_ARENA_MAX_SCRATCH_TASKS other tasks hold scopes
+ */
+esp_err_t mem_arena_scratch_begin(mem_arena_class_t cls, size_t *mark);
+
+/**
+ * @brief Close a scratch scope, releasing everything allocated since it opened
+ *
+ * @param cls Placement class
+ * @param mark Mark returned by mem_arena_scratch_begin()
+ */
+void mem_arena_scratch_end(mem_arena_class_t cls, size_t mark);
+
+/**
+ * @brief Check whether an arena has its memory reserved
+ *
+ * @param cls Placement class
+ * @return bool true if allocations can be served from the arena
+ */
+bool mem_arena_available(mem_arena_class_t cls);
+
+/**
+ * @brief Get arena usage statistics
+ *
+ * @param cls Placement class
+ * @param[out] stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t mem_arena_get_stats(mem_arena_class_t cls, mem_arena_stats_t *stats);
+
+/**
+ * @brief Log usage and high-water marks of all arenas
+ */
+void mem_arena_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
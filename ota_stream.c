@@ -0,0 +1,457 @@
+/**
+ * @file ota_stream.c
+ * @brief Streaming OTA firmware writer implementation
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "mbedtls/sha256.h"
+
+#include "ota_stream.h"
+#include "mem_arena.h"
+
+#ifdef OTA_STREAM_HOST
+#include <time.h>
+#include <unistd.h>
+
+#define ESP_LOGI(tag, fmt, ...) printf("I (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) printf("W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define TRACE(...) ((void)0)
+#else
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "tunerstudio_realtime.h"
+#include "trace.h"
+#endif
+
+static const char *TAG = "ota_stream";
+
+struct ota_stream {
+    bool active;
+    ota_stream_config_t config;
+    size_t image_size;
+    bool verify;
+    uint8_t expected_sha256[OTA_STREAM_SHA256_SIZE];
+    mbedtls_sha256_context sha;
+    uint8_t *chunk;                  // PSRAM, held in a scratch scope for the session
+    size_t chunk_len;
+    size_t arena_mark;
+    uint32_t interval_ms;            // Current pacing interval between chunk writes
+    int64_t last_write_us;
+    bool warned_unpaced;             // "No latency source" already logged for this update
+#ifdef OTA_STREAM_HOST
+    FILE *file;
+#else
+    const esp_partition_t *partition;
+    esp_ota_handle_t handle;
+#endif
+};
+
+// Only one update can run at a time, so the session is static; its buffers
+// come from the PSRAM arena and are returned when the update ends
+static ota_stream_t s_stream;
+static ota_stream_stats_t s_stats;
+
+static int64_t now_us(void)
+{
+#ifdef OTA_STREAM_HOST
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+    return esp_timer_get_time();
+#endif
+}
+
+static void sleep_ms(uint32_t ms)
+{
+#ifdef OTA_STREAM_HOST
+    usleep(ms * 1000);
+#else
+    vTaskDelay(pdMS_TO_TICKS(ms) ? pdMS_TO_TICKS(ms) : 1);
+#endif
+}
+
+// Current pipeline latency; false if no source has a measurement to offer
+static bool current_latency_us(const ota_stream_t *stream, uint32_t *latency)
+{
+    if (stream->config.latency_fn != NULL) {
+        *latency = stream->config.latency_fn();
+        return true;
+    }
+#ifndef OTA_STREAM_HOST
+    // Sequence 0 means the mapping task never published, so the average is not a measurement
+    ts_realtime_snapshot_t snapshot;
+    if (ts_realtime_read(&snapshot) == ESP_OK && snapshot.sequence != 0) {
+        *latency = snapshot.latency_avg_us;
+        return true;
+    }
+#endif
+    return false;
+}
+
+// Wait until the next chunk may be written. The interval doubles while the
+// pipeline is over its latency budget and decays back to the minimum once it recovers.
+static void pace_chunk(ota_stream_t *stream)
+{
+    uint32_t latency = 0;
+    if (!current_latency_us(stream, &latency)) {
+        // Never silently run unthrottled: say so once and count every chunk it affects
+        s_stats.chunks_unpaced++;
+        if (!stream->warned_unpaced) {
+            ESP_LOGW(TAG, "No pipeline latency source (latency_fn not set and the realtime snapshot "
+                     "was never published); writing at the minimum chunk interval without pacing");
+            stream->warned_unpaced = true;
+        }
+    }
+    if (latency > s_stats.latency_max_us) {
+        s_stats.latency_max_us = latency;
+    }
+
+    if (stream->config.latency_budget_us != 0 && latency > stream->config.latency_budget_us) {
+        uint32_t doubled = stream->interval_ms ? stream->interval_ms * 2 : 1;
+        stream->interval_ms = doubled < stream->config.max_chunk_interval_ms ?
+                              doubled : stream->config.max_chunk_interval_ms;
+        s_stats.chunks_throttled++;
+    } else if (stream->interval_ms > stream->config.min_chunk_interval_ms) {
+        stream->interval_ms /= 2;
+        if (stream->interval_ms < stream->config.min_chunk_interval_ms) {
+            stream->interval_ms = stream->config.min_chunk_interval_ms;
+        }
+    }
+
+    int64_t elapsed_ms = (now_us() - stream->last_write_us) / 1000;
+    if (stream->last_write_us != 0 && elapsed_ms < stream->interval_ms) {
+        uint32_t wait_ms = stream->interval_ms - (uint32_t)elapsed_ms;
+        sleep_ms(wait_ms);
+        s_stats.throttle_time_ms += wait_ms;
+    }
+}
+
+static esp_err_t partition_write(ota_stream_t *stream, const uint8_t *data, size_t len)
+{
+#ifdef OTA_STREAM_HOST
+    if (fwrite(data, 1, len, stream->file) != len) {
+        return ESP_FAIL;
+    }
+    // Make the host build pay the write cost like the flash does
+    fflush(stream->file);
+    return ESP_OK;
+#else
+    return esp_ota_write(stream->handle, data, len);
+#endif
+}
+
+static esp_err_t flush_chunk(ota_stream_t *stream)
+{
+    if (stream->chunk_len == 0) {
+        return ESP_OK;
+    }
+
+    pace_chunk(stream);
+
+    mbedtls_sha256_update(&stream->sha, stream->chunk, stream->chunk_len);
+
+    int64_t start = now_us();
+    esp_err_t ret = partition_write(stream, stream->chunk, stream->chunk_len);
+    stream->last_write_us = now_us();
+
+    uint32_t write_us = (uint32_t)(stream->last_write_us - start);
+    TRACE(TRACE_OTA_CHUNK, s_stats.bytes_written, write_us, stream->interval_ms, s_stats.latency_max_us);
+    if (write_us > s_stats.write_time_max_us) {
+        s_stats.write_time_max_us = write_us;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Partition write failed at offset %u (%s)",
+                 (unsigned)s_stats.bytes_written, esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_stats.bytes_written += stream->chunk_len;
+    s_stats.chunks_written++;
+    stream->chunk_len = 0;
+
+    if (stream->config.progress_cb != NULL) {
+        stream->config.progress_cb(s_stats.bytes_written, stream->image_size, stream->config.user_ctx);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_stream_begin(const ota_stream_config_t *config, size_t image_size,
+                           const uint8_t *expected_sha256, ota_stream_t **stream)
+{
+    if (config == NULL || stream == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_stream.active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ota_stream_t *s = &s_stream;
+    memset(s, 0, sizeof(*s));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s->config = *config;
+    s->image_size = image_size;
+    s->interval_ms = config->min_chunk_interval_ms;
+    if (s->config.max_chunk_interval_ms < s->config.min_chunk_interval_ms) {
+        s->config.max_chunk_interval_ms = s->config.min_chunk_interval_ms;
+    }
+    if (expected_sha256 != NULL) {
+        s->verify = true;
+        memcpy(s->expected_sha256, expected_sha256, OTA_STREAM_SHA256_SIZE);
+    }
+
+#ifdef OTA_STREAM_HOST
+    if (config->host_path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s->file = fopen(config->host_path, "wb");
+    if (s->file == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", config->host_path);
+        return ESP_FAIL;
+    }
+#else
+    s->partition = esp_ota_get_next_update_partition(NULL);
+    if (s->partition == NULL) {
+        ESP_LOGE(TAG, "No OTA update partition available");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (image_size > s->partition->size) {
+        ESP_LOGE(TAG, "Image of %u bytes does not fit partition %s", (unsigned)image_size, s->partition->label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // Erase sector by sector inside esp_ota_write() instead of the whole range up
+    // front, so each erase is paced and timed with the chunk that needs it
+    esp_err_t ret = esp_ota_begin(s->partition, OTA_WITH_SEQUENTIAL_WRITES, &s->handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_begin failed (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+#endif
+
+    if (mem_arena_scratch_begin(MEM_ARENA_BULK, &s->arena_mark) == ESP_OK) {
+        s->chunk = mem_arena_alloc(MEM_ARENA_BULK, OTA_STREAM_CHUNK_SIZE, TAG);
+        if (s->chunk == NULL) {
+            mem_arena_scratch_end(MEM_ARENA_BULK, s->arena_mark);
+        }
+    }
+    if (s->chunk == NULL) {
+#ifdef OTA_STREAM_HOST
+        fclose(s->file);
+#else
+        esp_ota_abort(s->handle);
+#endif
+        return ESP_ERR_NO_MEM;
+    }
+
+    mbedtls_sha256_init(&s->sha);
+    mbedtls_sha256_starts(&s->sha, 0);
+    s->active = true;
+
+    ESP_LOGI(TAG, "Streaming update started (%u bytes)", (unsigned)image_size);
+    *stream = s;
+    return ESP_OK;
+}
+
+esp_err_t ota_stream_write(ota_stream_t *stream, const uint8_t *data, size_t len)
+{
+    if (stream == NULL || !stream->active || (data == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (stream->image_size != 0 && s_stats.bytes_written + stream->chunk_len + len > stream->image_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    while (len > 0) {
+        size_t n = OTA_STREAM_CHUNK_SIZE - stream->chunk_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(&stream->chunk[stream->chunk_len], data, n);
+        stream->chunk_len += n;
+        data += n;
+        len -= n;
+
+        if (stream->chunk_len == OTA_STREAM_CHUNK_SIZE) {
+            esp_err_t ret = flush_chunk(stream);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static void stream_release(ota_stream_t *stream)
+{
+    mbedtls_sha256_free(&stream->sha);
+    // Also returns buffers the caller allocated during the session
+    mem_arena_scratch_end(MEM_ARENA_BULK, stream->arena_mark);
+    stream->chunk = NULL;
+#ifdef OTA_STREAM_HOST
+    if (stream->file != NULL) {
+        fclose(stream->file);
+        stream->file = NULL;
+    }
+#endif
+    stream->active = false;
+}
+
+esp_err_t ota_stream_abort(ota_stream_t *stream)
+{
+    if (stream == NULL || !stream->active) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#ifndef OTA_STREAM_HOST
+    esp_ota_abort(stream->handle);
+#endif
+    stream_release(stream);
+    ESP_LOGW(TAG, "Update aborted after %u bytes", (unsigned)s_stats.bytes_written);
+    return ESP_OK;
+}
+
+esp_err_t ota_stream_finish(ota_stream_t *stream, uint8_t *sha256)
+{
+    if (stream == NULL || !stream->active) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = flush_chunk(stream);
+    if (ret != ESP_OK) {
+        ota_stream_abort(stream);
+        return ret;
+    }
+    if (stream->image_size != 0 && s_stats.bytes_written != stream->image_size) {
+        ESP_LOGE(TAG, "Image truncated: %u of %u bytes", (unsigned)s_stats.bytes_written,
+                 (unsigned)stream->image_size);
+        ota_stream_abort(stream);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t digest[OTA_STREAM_SHA256_SIZE];
+    mbedtls_sha256_finish(&stream->sha, digest);
+    if (sha256 != NULL) {
+        memcpy(sha256, digest, sizeof(digest));
+    }
+    if (stream->verify && memcmp(digest, stream->expected_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Image SHA-256 mismatch");
+        ota_stream_abort(stream);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+#ifndef OTA_STREAM_HOST
+    ret = esp_ota_end(stream->handle);
+    if (ret == ESP_OK) {
+        ret = esp_ota_set_boot_partition(stream->partition);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to finalize update (%s)", esp_err_to_name(ret));
+        stream_release(stream);
+        return ret;
+    }
+#endif
+
+    stream_release(stream);
+    ESP_LOGI(TAG, "Update complete: %u bytes, %u chunks, %u throttled, %u unpaced, %u ms paced, "
+             "max write %u us, max latency %u us",
+             (unsigned)s_stats.bytes_written, (unsigned)s_stats.chunks_written,
+             (unsigned)s_stats.chunks_throttled, (unsigned)s_stats.chunks_unpaced,
+             (unsigned)s_stats.throttle_time_ms, (unsigned)s_stats.write_time_max_us,
+             (unsigned)s_stats.latency_max_us);
+    if (s_stats.chunks_unpaced != 0) {
+        ESP_LOGW(TAG, "%u of %u chunks were written without a latency measurement",
+                 (unsigned)s_stats.chunks_unpaced, (unsigned)s_stats.chunks_written);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_stream_get_stats(ota_stream_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
+
+#ifndef OTA_STREAM_HOST
+static bool parse_sha256_hex(const char *hex, uint8_t *out)
+{
+    for (int i = 0; i < OTA_STREAM_SHA256_SIZE; i++) {
+        unsigned int byte;
+        if (sscanf(&hex[i * 2], "%2x", &byte) != 1) {
+            return false;
+        }
+        out[i] = byte;
+    }
+    return hex[OTA_STREAM_SHA256_SIZE * 2] == '\0';
+}
+
+esp_err_t ota_stream_http_upload(httpd_req_t *req, const ota_stream_config_t *config)
+{
+    uint8_t *recv_buf;
+    char hash_hex[OTA_STREAM_SHA256_SIZE * 2 + 1];
+    uint8_t expected[OTA_STREAM_SHA256_SIZE];
+    bool have_hash = false;
+
+    if (httpd_req_get_hdr_value_str(req, "X-Firmware-SHA256", hash_hex, sizeof(hash_hex)) == ESP_OK) {
+        if (!parse_sha256_hex(hash_hex, expected)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid X-Firmware-SHA256 header");
+            return ESP_ERR_INVALID_ARG;
+        }
+        have_hash = true;
+    }
+
+    ota_stream_t *stream;
+    esp_err_t ret = ota_stream_begin(config, req->content_len, have_hash ? expected : NULL, &stream);
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start update");
+        return ret;
+    }
+
+    // Allocated inside the session's scratch scope, so it is released with the session
+    recv_buf = mem_arena_alloc(MEM_ARENA_BULK, OTA_STREAM_CHUNK_SIZE, TAG);
+    if (recv_buf == NULL) {
+        ota_stream_abort(stream);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t remaining = req->content_len;
+    while (remaining > 0) {
+        int received = httpd_req_recv(req, (char *)recv_buf,
+                                      remaining < OTA_STREAM_CHUNK_SIZE ? remaining : OTA_STREAM_CHUNK_SIZE);
+        if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (received <= 0) {
+            ota_stream_abort(stream);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Upload interrupted");
+            return ESP_FAIL;
+        }
+
+        ret = ota_stream_write(stream, recv_buf, received);
+        if (ret != ESP_OK) {
+            ota_stream_abort(stream);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Flash write failed");
+            return ret;
+        }
+        remaining -= received;
+    }
+
+    ret = ota_stream_finish(stream, NULL);
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            ret == ESP_ERR_INVALID_CRC ? "Image hash mismatch" : "Image verification failed");
+        return ret;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, "{\"status\":\"ok\"}", HTTPD_RESP_USE_STRLEN);
+}
+#endif
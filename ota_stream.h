@@ -0,0 +1,157 @@
+/**
+ * @file ota_stream.h
+ * @brief Streaming OTA firmware writer
+ *
+ * This file contains the declarations for the streaming firmware update path
+ * used by `/api/firmware/upload`. The image is received and written to the
+ * OTA partition in fixed-size chunks with an incremental SHA-256, so the
+ * image is never buffered in full. Chunk writes are paced against the
+ * measured input-to-output latency of the mapping pipeline, because flash
+ * writes stall cache access and show up as output jitter. When no latency
+ * source has a measurement, chunks are written at the minimum interval; a
+ * warning is logged and the chunks are counted in `chunks_unpaced`.
+ *
+ * Building with OTA_STREAM_HOST defined replaces the OTA partition with a
+ * regular file and FreeRTOS delays with usleep(), for replaying HID traffic
+ * against an update on a development machine. Session buffers come from the
+ * PSRAM arena, so host builds link mem_arena.c built with MEM_ARENA_HOST.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifndef OTA_STREAM_HOST
+#include "esp_http_server.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Size of one chunk written to the OTA partition (one flash sector)
+ *
+ * The partition is erased one sector at a time as chunks reach it, so each
+ * chunk write includes at most one sector erase.
+ */
+#define OTA_STREAM_CHUNK_SIZE 4096
+
+/**
+ * @brief Size of a SHA-256 digest in bytes
+ */
+#define OTA_STREAM_SHA256_SIZE 32
+
+/**
+ * @brief Pipeline latency provider, returns the current input-to-output latency in microseconds
+ */
+typedef uint32_t (*ota_stream_latency_fn_t)(void);
+
+/**
+ * @brief Progress callback, invoked after each chunk is written
+ */
+typedef void (*ota_stream_progress_cb_t)(size_t written, size_t total, void *user_ctx);
+
+/**
+ * @brief Streaming OTA configuration
+ */
+typedef struct {
+    uint32_t latency_budget_us;          /*!< Pipeline latency above which chunk writes are throttled */
+    uint32_t min_chunk_interval_ms;      /*!< Minimum delay between chunk writes */
+    uint32_t max_chunk_interval_ms;      /*!< Maximum delay between chunk writes when throttled */
+    ota_stream_latency_fn_t latency_fn;  /*!< Latency provider (NULL uses the TunerStudio realtime snapshot average once published) */
+    ota_stream_progress_cb_t progress_cb;/*!< Progress callback (may be NULL) */
+    void *user_ctx;                      /*!< User context for the progress callback */
+    const char *host_path;               /*!< Image file path (OTA_STREAM_HOST builds only) */
+} ota_stream_config_t;
+
+/**
+ * @brief Streaming OTA statistics for the current or last update
+ */
+typedef struct {
+    size_t bytes_written;                /*!< Bytes written to the partition */
+    uint32_t chunks_written;             /*!< Chunks written */
+    uint32_t chunks_throttled;           /*!< Chunks delayed because latency exceeded the budget */
+    uint32_t chunks_unpaced;             /*!< Chunks written with no latency measurement available (not paced) */
+    uint32_t throttle_time_ms;           /*!< Total time spent waiting between chunks */
+    uint32_t write_time_max_us;          /*!< Longest single chunk write, including its sector erase */
+    uint32_t latency_max_us;             /*!< Highest pipeline latency observed during the update */
+} ota_stream_stats_t;
+
+/**
+ * @brief Streaming OTA session (one update at a time)
+ */
+typedef struct ota_stream ota_stream_t;
+
+/**
+ * @brief Begin a streaming update
+ *
+ * @param config Pointer to the configuration
+ * @param image_size Total image size in bytes (0 if unknown)
+ * @param expected_sha256 Expected SHA-256 of the image (NULL to skip verification)
+ * @param[out] stream Pointer to store the session handle
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if an update is already running
+ */
+esp_err_t ota_stream_begin(const ota_stream_config_t *config, size_t image_size,
+                           const uint8_t *expected_sha256, ota_stream_t **stream);
+
+/**
+ * @brief Write image data
+ *
+ * Data is collected into chunk-sized blocks; each full block is hashed and
+ * written to the partition, subject to latency-based pacing.
+ *
+ * @param stream Session handle
+ * @param data Pointer to the data
+ * @param len Length of the data in bytes
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ota_stream_write(ota_stream_t *stream, const uint8_t *data, size_t len);
+
+/**
+ * @brief Finish the update, verify the hash and select the new image for boot
+ *
+ * @param stream Session handle (released by this call)
+ * @param[out] sha256 Buffer to store the computed SHA-256 (may be NULL)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_CRC on hash mismatch,
+ *                   ESP_ERR_INVALID_SIZE if fewer bytes than image_size were written
+ */
+esp_err_t ota_stream_finish(ota_stream_t *stream, uint8_t *sha256);
+
+/**
+ * @brief Abort the update and release the session
+ *
+ * @param stream Session handle
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ota_stream_abort(ota_stream_t *stream);
+
+/**
+ * @brief Get statistics for the current or last update
+ *
+ * @param[out] stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ota_stream_get_stats(ota_stream_stats_t *stats);
+
+#ifndef OTA_STREAM_HOST
+/**
+ * @brief Stream an HTTP upload request body into the OTA partition
+ *
+ * Intended to be called from the `/api/firmware/upload` handler. The body
+ * is read in OTA_STREAM_CHUNK_SIZE pieces. An optional `X-Firmware-SHA256`
+ * header (64 hex characters) is verified against the image.
+ *
+ * @param req HTTP request
+ * @param config Pointer to the configuration
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ota_stream_http_upload(httpd_req_t *req, const ota_stream_config_t *config);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
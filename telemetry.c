@@ -0,0 +1,649 @@
+/**
+ * @file telemetry.c
+ * @brief Live telemetry stream over WebSocket implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "telemetry.h"
+#include "trace.h"
+#include "mem_arena.h"
+
+static const char *TAG = "telemetry";
+
+// Producer ring size in records (power of two). The ring is drained completely every
+// tick, so it has to hold one tick of traffic: a saturated 500 kbit/s bus is about
+// 4000 frames/s, 200 per default tick, plus the input and output records.
+#define TELEMETRY_RING_SIZE 512
+
+// Batch frames needed to carry a full ring
+#define TELEMETRY_FRAMES_PER_TICK (TELEMETRY_RING_SIZE / TELEMETRY_MAX_BATCH_RECORDS)
+
+// Frames queued to a client but not yet handed to the socket. One full tick may still
+// be in flight while the next is built; beyond that the client is behind.
+#define TELEMETRY_MAX_IN_FLIGHT (2 * TELEMETRY_FRAMES_PER_TICK)
+
+// Upper bound for the per-client decimation factor
+#define TELEMETRY_MAX_DECIMATION 8
+
+#define TELEMETRY_MAGIC 'T'
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_FRAME_SIZE (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_BATCH_RECORDS * TELEMETRY_RECORD_SIZE)
+
+_Static_assert(sizeof(telemetry_record_t) == TELEMETRY_RECORD_SIZE, "telemetry record layout changed");
+
+typedef struct {
+    uint32_t time_ms;
+    telemetry_record_t record;
+} telemetry_entry_t;
+
+typedef struct telemetry_client telemetry_client_t;
+
+typedef struct {
+    telemetry_client_t *client;
+    uint8_t *frame;                  // TELEMETRY_FRAME_SIZE bytes in the bulk arena
+    size_t len;
+    bool busy;                       // Queued to the httpd task
+} telemetry_send_t;
+
+struct telemetry_client {
+    bool connected;
+    int fd;
+    uint8_t mask;
+    uint8_t decimation;
+    atomic_int in_flight;
+    uint32_t records_dropped;        // Dropped since the last frame sent to this client
+    telemetry_send_t sends[TELEMETRY_MAX_IN_FLIGHT];
+    telemetry_client_stats_t stats;
+};
+
+static telemetry_config_t s_config;
+static bool s_initialized = false;
+static httpd_handle_t s_server = NULL;
+static TaskHandle_t s_task = NULL;
+
+// Producer ring (internal RAM, written on the input path); the critical section
+// only covers index updates and a record copy
+static portMUX_TYPE s_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+static telemetry_entry_t *s_ring = NULL;
+static uint32_t s_ring_head = 0;
+static uint32_t s_ring_tail = 0;
+static uint32_t s_records_produced = 0;
+static uint32_t s_records_overflowed = 0;
+static uint32_t s_overflow_reported = 0;     // Overflow count already charged to the clients
+
+// Client table, shared between the httpd task and the telemetry task. It holds the
+// atomics and busy flags, so it stays in internal RAM (atomic read-modify-write on
+// PSRAM is not reliable on Xtensa); only the frame buffers it points to are in PSRAM.
+static portMUX_TYPE s_client_lock = portMUX_INITIALIZER_UNLOCKED;
+static telemetry_client_t *s_clients = NULL;
+static uint64_t s_drain_time_us = 0;         // 64-bit, so only touched under s_client_lock
+
+// Union of the masks of connected clients, written under s_client_lock and read
+// lock-free by producers so unsubscribed records cost a single load
+static volatile uint8_t s_subscribed_mask = 0;
+
+// One tick drained from the ring (PSRAM), only touched by the telemetry task
+static telemetry_entry_t *s_batch = NULL;
+
+// Must be called with s_client_lock held
+static void update_subscribed_mask_locked(void)
+{
+    uint8_t mask = 0;
+
+    for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+        if (s_clients[c].connected) {
+            mask |= s_clients[c].mask;
+        }
+    }
+    s_subscribed_mask = mask;
+}
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void ring_push(const telemetry_record_t *record)
+{
+    uint32_t time_ms = now_ms();
+
+    portENTER_CRITICAL(&s_ring_lock);
+    if (s_ring_head - s_ring_tail >= TELEMETRY_RING_SIZE) {
+        // Never block or overwrite unread records; the consumer sees the gap via the counter
+        s_records_overflowed++;
+    } else {
+        telemetry_entry_t *entry = &s_ring[s_ring_head & (TELEMETRY_RING_SIZE - 1)];
+        entry->time_ms = time_ms;
+        entry->record = *record;
+        s_ring_head++;
+        s_records_produced++;
+    }
+    portEXIT_CRITICAL(&s_ring_lock);
+}
+
+void telemetry_record_input(uint8_t device_idx, uint8_t input_type, uint8_t input_index, int32_t value)
+{
+    if (!(s_subscribed_mask & TELEMETRY_MASK_INPUT)) {
+        return;
+    }
+
+    telemetry_record_t record = {
+        .type = TELEMETRY_RECORD_INPUT,
+        .source = device_idx,
+    };
+    record.input.input_type = input_type;
+    record.input.input_index = input_index;
+    record.input.value = value;
+    ring_push(&record);
+}
+
+void telemetry_record_output(uint8_t channel, uint16_t mapping_idx, uint32_t can_id, uint8_t len,
+                             esp_err_t status, uint32_t latency_us)
+{
+    if (!(s_subscribed_mask & TELEMETRY_MASK_OUTPUT)) {
+        return;
+    }
+
+    telemetry_record_t record = {
+        .type = TELEMETRY_RECORD_OUTPUT,
+        .source = channel,
+    };
+    record.output.mapping_idx = mapping_idx;
+    record.output.len = len;
+    record.output.status = (status == ESP_OK) ? 0 : 1;
+    record.output.can_id = can_id;
+    record.output.latency_us = latency_us;
+    ring_push(&record);
+}
+
+void telemetry_record_can(uint32_t id, bool extended, uint8_t dlc, const uint8_t *data)
+{
+    if (!(s_subscribed_mask & TELEMETRY_MASK_CAN)) {
+        return;
+    }
+
+    if (dlc > 8) {
+        dlc = 8;
+    }
+
+    telemetry_record_t record = {
+        .type = TELEMETRY_RECORD_CAN,
+        .source = dlc | (extended ? 0x80 : 0),
+    };
+    record.can.id = id;
+    if (data != NULL) {
+        memcpy(record.can.data, data, dlc);
+    }
+    ring_push(&record);
+}
+
+// Copy out up to max records. Each critical section copies at most one batch, so
+// producers are never held off for a whole ring.
+static size_t ring_drain(telemetry_entry_t *out, size_t max, uint32_t *overflowed)
+{
+    size_t count = 0;
+    size_t copied;
+
+    do {
+        copied = 0;
+        portENTER_CRITICAL(&s_ring_lock);
+        while (s_ring_tail != s_ring_head && copied < TELEMETRY_MAX_BATCH_RECORDS && count < max) {
+            out[count++] = s_ring[s_ring_tail & (TELEMETRY_RING_SIZE - 1)];
+            s_ring_tail++;
+            copied++;
+        }
+        *overflowed = s_records_overflowed;
+        portEXIT_CRITICAL(&s_ring_lock);
+    } while (copied == TELEMETRY_MAX_BATCH_RECORDS && count < max);
+
+    return count;
+}
+
+static size_t build_frame(telemetry_client_t *client, const telemetry_entry_t *entries, size_t count, uint8_t *frame)
+{
+    uint32_t base_ms = entries[0].time_ms;
+    uint16_t records = 0;
+    uint8_t *p = frame + TELEMETRY_HEADER_SIZE;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!(client->mask & (1 << entries[i].record.type))) {
+            continue;
+        }
+        telemetry_record_t *record = (telemetry_record_t *)p;
+        *record = entries[i].record;
+        record->time_offset_ms = (uint16_t)(entries[i].time_ms - base_ms);
+        p += TELEMETRY_RECORD_SIZE;
+        records++;
+    }
+
+    if (records == 0) {
+        return 0;
+    }
+
+    frame[0] = TELEMETRY_MAGIC;
+    frame[1] = TELEMETRY_VERSION;
+    memcpy(&frame[2], &records, sizeof(records));
+    memcpy(&frame[4], &base_ms, sizeof(base_ms));
+    memcpy(&frame[8], &client->records_dropped, sizeof(client->records_dropped));
+    return p - frame;
+}
+
+// Runs in the httpd task
+static void send_work(void *arg)
+{
+    telemetry_send_t *send = (telemetry_send_t *)arg;
+    telemetry_client_t *client = send->client;
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    bool dropped = false;
+
+    // The fd may have been closed and reused by a plain HTTP connection since the frame was queued
+    if (client->connected && httpd_ws_get_fd_info(s_server, client->fd) == HTTPD_WS_CLIENT_WEBSOCKET) {
+        httpd_ws_frame_t ws_frame = {
+            .final = true,
+            .fragmented = false,
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = send->frame,
+            .len = send->len,
+        };
+        ret = httpd_ws_send_frame_async(s_server, client->fd, &ws_frame);
+    }
+
+    portENTER_CRITICAL(&s_client_lock);
+    client->stats.send_time_us += esp_timer_get_time() - start;
+    if (ret == ESP_OK) {
+        client->stats.batches_sent++;
+        client->stats.bytes_sent += send->len;
+    } else if (client->connected) {
+        // Release the slot before in_flight drops so a new handshake cannot race the removal
+        client->connected = false;
+        update_subscribed_mask_locked();
+        dropped = true;
+    }
+    send->busy = false;
+    portEXIT_CRITICAL(&s_client_lock);
+    atomic_fetch_sub(&client->in_flight, 1);
+
+    if (dropped) {
+        ESP_LOGI(TAG, "Telemetry client fd %d disconnected (%s)", client->fd, esp_err_to_name(ret));
+    }
+}
+
+// Queue one batch frame to a client; false if its records had to be dropped
+static bool queue_frame(telemetry_client_t *client, const telemetry_entry_t *entries, size_t count)
+{
+    telemetry_send_t *send = NULL;
+
+    portENTER_CRITICAL(&s_client_lock);
+    for (int i = 0; i < TELEMETRY_MAX_IN_FLIGHT; i++) {
+        if (!client->sends[i].busy) {
+            send = &client->sends[i];
+            send->busy = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_client_lock);
+    if (send == NULL) {
+        return false;
+    }
+
+    send->client = client;
+    send->len = build_frame(client, entries, count, send->frame);
+    if (send->len == 0) {
+        // Nothing this client subscribes to
+        send->busy = false;
+        return true;
+    }
+
+    atomic_fetch_add(&client->in_flight, 1);
+    if (httpd_queue_work(s_server, send_work, send) != ESP_OK) {
+        atomic_fetch_sub(&client->in_flight, 1);
+        send->busy = false;
+        return false;
+    }
+    client->records_dropped = 0;
+    return true;
+}
+
+// Send one tick of records to every client, split into batch frames. Records lost to a
+// ring overflow are charged to every client; everything else lost here is the client's
+// own backpressure.
+static void dispatch_tick(const telemetry_entry_t *entries, size_t count, uint32_t lost, uint32_t tick)
+{
+    int frames = (count + TELEMETRY_MAX_BATCH_RECORDS - 1) / TELEMETRY_MAX_BATCH_RECORDS;
+
+    for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+        telemetry_client_t *client = &s_clients[c];
+        if (!client->connected) {
+            continue;
+        }
+
+        client->records_dropped += lost;
+        client->stats.records_dropped += lost;
+        if (count == 0) {
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+        int in_flight = atomic_load(&client->in_flight);
+
+        // Backpressure: a client whose earlier frames leave no room for this tick gets decimated
+        if (in_flight + frames > TELEMETRY_MAX_IN_FLIGHT) {
+            if (client->decimation < TELEMETRY_MAX_DECIMATION) {
+                client->decimation *= 2;
+            }
+            client->stats.batches_dropped += frames;
+            client->stats.records_dropped += count;
+            client->records_dropped += count;
+            continue;
+        }
+        if (in_flight == 0 && client->decimation > 1) {
+            client->decimation /= 2;
+        }
+        if (tick % client->decimation != 0) {
+            client->stats.batches_dropped += frames;
+            client->stats.records_dropped += count;
+            client->records_dropped += count;
+            continue;
+        }
+
+        for (size_t offset = 0; offset < count; offset += TELEMETRY_MAX_BATCH_RECORDS) {
+            size_t n = count - offset;
+            if (n > TELEMETRY_MAX_BATCH_RECORDS) {
+                n = TELEMETRY_MAX_BATCH_RECORDS;
+            }
+            if (!queue_frame(client, &entries[offset], n)) {
+                client->stats.batches_dropped++;
+                client->stats.records_dropped += n;
+                client->records_dropped += n;
+            }
+        }
+
+        portENTER_CRITICAL(&s_client_lock);
+        client->stats.build_time_us += esp_timer_get_time() - start;
+        client->stats.decimation = client->decimation;
+        portEXIT_CRITICAL(&s_client_lock);
+    }
+}
+
+static void telemetry_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t tick = 0;
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(s_config.tick_ms));
+        tick++;
+
+        // Drain the whole ring so a busy bus only costs slow clients, not everyone
+        uint32_t overflowed;
+        int64_t start = esp_timer_get_time();
+        size_t count = ring_drain(s_batch, TELEMETRY_RING_SIZE, &overflowed);
+        int64_t elapsed = esp_timer_get_time() - start;
+
+        portENTER_CRITICAL(&s_client_lock);
+        s_drain_time_us += elapsed;
+        portEXIT_CRITICAL(&s_client_lock);
+
+        uint32_t lost = overflowed - s_overflow_reported;
+        s_overflow_reported = overflowed;
+        if ((count == 0 && lost == 0) || s_server == NULL) {
+            continue;
+        }
+        dispatch_tick(s_batch, count, lost, tick);
+        TRACE(TRACE_TELEMETRY_BATCH, count, tick);
+    }
+}
+
+esp_err_t telemetry_init(const telemetry_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    if (s_config.tick_ms == 0) {
+        s_config.tick_ms = TELEMETRY_DEFAULT_TICK_MS;
+    }
+
+    // Frames and the batch live in the bulk arena; without PSRAM telemetry stays off
+    if (!mem_arena_available(MEM_ARENA_BULK)) {
+        ESP_LOGW(TAG, "Bulk arena unavailable, telemetry disabled");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (s_ring == NULL) {
+        s_ring = mem_arena_alloc(MEM_ARENA_HOT, TELEMETRY_RING_SIZE * sizeof(telemetry_entry_t), TAG);
+        s_clients = mem_arena_alloc(MEM_ARENA_HOT, TELEMETRY_MAX_CLIENTS * sizeof(telemetry_client_t), TAG);
+        s_batch = mem_arena_alloc(MEM_ARENA_BULK, TELEMETRY_RING_SIZE * sizeof(telemetry_entry_t), TAG);
+        if (s_ring == NULL || s_clients == NULL || s_batch == NULL) {
+            s_ring = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+        for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+            for (int i = 0; i < TELEMETRY_MAX_IN_FLIGHT; i++) {
+                s_clients[c].sends[i].frame = mem_arena_alloc(MEM_ARENA_BULK, TELEMETRY_FRAME_SIZE, TAG);
+                if (s_clients[c].sends[i].frame == NULL) {
+                    s_ring = NULL;
+                    return ESP_ERR_NO_MEM;
+                }
+            }
+        }
+    }
+
+    s_ring_head = s_ring_tail = 0;
+    s_overflow_reported = s_records_overflowed;
+
+    if (xTaskCreate(telemetry_task, "telemetry", 4096, NULL, s_config.task_priority, &s_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_initialized = true;
+    ESP_LOGI(TAG, "Telemetry initialized (tick %lu ms)", (unsigned long)s_config.tick_ms);
+    return ESP_OK;
+}
+
+// Free the slot of the client on this socket; in-flight frames are discarded by send_work()
+static void client_release(int fd)
+{
+    bool released = false;
+
+    portENTER_CRITICAL(&s_client_lock);
+    for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+        if (s_clients[c].connected && s_clients[c].fd == fd) {
+            s_clients[c].connected = false;
+            released = true;
+        }
+    }
+    update_subscribed_mask_locked();
+    portEXIT_CRITICAL(&s_client_lock);
+
+    if (released) {
+        ESP_LOGI(TAG, "Telemetry client fd %d closed", fd);
+    }
+}
+
+void telemetry_on_close(httpd_handle_t server, int fd)
+{
+    if (s_initialized) {
+        client_release(fd);
+    }
+}
+
+static esp_err_t telemetry_ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+
+    if (req->method == HTTP_GET) {
+        // Handshake: allocate a client slot
+        telemetry_client_t *client = NULL;
+        portENTER_CRITICAL(&s_client_lock);
+        for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+            if (!s_clients[c].connected && atomic_load(&s_clients[c].in_flight) == 0) {
+                client = &s_clients[c];
+                memset(&client->stats, 0, sizeof(client->stats));
+                client->connected = true;
+                client->fd = fd;
+                client->mask = TELEMETRY_MASK_ALL;
+                client->decimation = 1;
+                client->records_dropped = 0;
+                client->stats.connected = true;
+                client->stats.fd = fd;
+                client->stats.decimation = 1;
+                update_subscribed_mask_locked();
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&s_client_lock);
+
+        if (client == NULL) {
+            ESP_LOGW(TAG, "No free telemetry client slot for fd %d", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Telemetry client connected (fd %d)", fd);
+        return ESP_OK;
+    }
+
+    // Client to server frames only carry a subscription mask
+    uint8_t buf[4];
+    httpd_ws_frame_t ws_frame = {
+        .payload = buf,
+    };
+    esp_err_t ret = httpd_ws_recv_frame(req, &ws_frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (ws_frame.len > sizeof(buf)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    ret = httpd_ws_recv_frame(req, &ws_frame, ws_frame.len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (ws_frame.type == HTTPD_WS_TYPE_CLOSE) {
+        client_release(fd);
+    } else if (ws_frame.type == HTTPD_WS_TYPE_BINARY && ws_frame.len == 1) {
+        portENTER_CRITICAL(&s_client_lock);
+        for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+            if (s_clients[c].connected && s_clients[c].fd == fd) {
+                s_clients[c].mask = buf[0] & TELEMETRY_MASK_ALL;
+            }
+        }
+        update_subscribed_mask_locked();
+        portEXIT_CRITICAL(&s_client_lock);
+    }
+    return ESP_OK;
+}
+
+// GET /api/telemetry/stats - per-client throughput and time cost, sent one object per chunk
+static esp_err_t telemetry_stats_handler(httpd_req_t *req)
+{
+    telemetry_stats_t stats;
+    char buf[256];
+    int len;
+
+    telemetry_get_stats(&stats);
+    httpd_resp_set_type(req, "application/json");
+
+    len = snprintf(buf, sizeof(buf),
+                   "{\"records_produced\":%lu,\"records_overflowed\":%lu,\"drain_us\":%llu,\"clients\":[",
+                   (unsigned long)stats.records_produced, (unsigned long)stats.records_overflowed,
+                   (unsigned long long)stats.drain_time_us);
+    httpd_resp_send_chunk(req, buf, len);
+
+    bool first = true;
+    for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+        const telemetry_client_stats_t *client = &stats.clients[c];
+        if (!client->connected) {
+            continue;
+        }
+        len = snprintf(buf, sizeof(buf),
+                       "%s{\"fd\":%d,\"decimation\":%d,\"batches_sent\":%lu,\"batches_dropped\":%lu,"
+                       "\"records_dropped\":%lu,\"bytes_sent\":%llu,\"build_us\":%llu,\"send_us\":%llu}",
+                       first ? "" : ",", client->fd, client->decimation,
+                       (unsigned long)client->batches_sent, (unsigned long)client->batches_dropped,
+                       (unsigned long)client->records_dropped, (unsigned long long)client->bytes_sent,
+                       (unsigned long long)client->build_time_us, (unsigned long long)client->send_time_us);
+        httpd_resp_send_chunk(req, buf, len);
+        first = false;
+    }
+
+    httpd_resp_send_chunk(req, "]}", 2);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+esp_err_t telemetry_register_handlers(httpd_handle_t server)
+{
+    if (server == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_initialized) {
+        // Telemetry failed to start; leave the endpoints unregistered rather than serve empty state
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    httpd_uri_t ws_uri = {
+        .uri = "/ws/telemetry",
+        .method = HTTP_GET,
+        .handler = telemetry_ws_handler,
+        .user_ctx = NULL,
+        .is_websocket = true
+    };
+
+    esp_err_t ret = httpd_register_uri_handler(server, &ws_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register telemetry endpoint (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t stats_uri = {
+        .uri = "/api/telemetry/stats",
+        .method = HTTP_GET,
+        .handler = telemetry_stats_handler,
+        .user_ctx = NULL
+    };
+
+    ret = httpd_register_uri_handler(server, &stats_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register telemetry stats endpoint (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_server = server;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_get_stats(telemetry_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&s_ring_lock);
+    stats->records_produced = s_records_produced;
+    stats->records_overflowed = s_records_overflowed;
+    portEXIT_CRITICAL(&s_ring_lock);
+
+    portENTER_CRITICAL(&s_client_lock);
+    stats->drain_time_us = s_drain_time_us;
+    for (int c = 0; c < TELEMETRY_MAX_CLIENTS; c++) {
+        stats->clients[c] = s_clients[c].stats;
+        stats->clients[c].connected = s_clients[c].connected;
+    }
+    portEXIT_CRITICAL(&s_client_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file telemetry.h
+ * @brief Live telemetry stream over WebSocket
+ *
+ * This file contains the declarations for the binary telemetry stream served
+ * on the `/ws/telemetry` WebSocket endpoint. Producers (the mapping task, the
+ * CAN receive path) append fixed-size records to a ring without ever
+ * blocking; a telemetry task drains the whole ring once per tick into as many
+ * batch frames per client as it takes. Clients that fall behind are decimated
+ * or have batches dropped rather than slowing down the producers or the
+ * other clients. Records of a type no connected client subscribes to are
+ * discarded before touching the ring.
+ *
+ * Batch frame layout (little-endian):
+ *   header: magic 'T' (u8), version (u8), record count (u16),
+ *           base timestamp ms (u32), records dropped for this client since
+ *           its previous frame, by backpressure or ring overflow (u32)
+ *   records: TELEMETRY_RECORD_SIZE bytes each, see telemetry_record_t
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of simultaneous telemetry clients
+ */
+#define TELEMETRY_MAX_CLIENTS 4
+
+/**
+ * @brief Maximum number of records per batch frame
+ */
+#define TELEMETRY_MAX_BATCH_RECORDS 128
+
+/**
+ * @brief Size of the batch frame header in bytes
+ */
+#define TELEMETRY_HEADER_SIZE 12
+
+/**
+ * @brief Size of one record in bytes
+ */
+#define TELEMETRY_RECORD_SIZE 16
+
+/**
+ * @brief Default telemetry tick period (ms)
+ */
+#define TELEMETRY_DEFAULT_TICK_MS 50
+
+/**
+ * @brief Telemetry record types
+ */
+typedef enum {
+    TELEMETRY_RECORD_INPUT = 1,      /*!< HID input value changed */
+    TELEMETRY_RECORD_OUTPUT = 2,     /*!< Output sent by a mapping */
+    TELEMETRY_RECORD_CAN = 3         /*!< CAN frame seen on the bus */
+} telemetry_record_type_t;
+
+/**
+ * @brief Record type subscription mask bits
+ *
+ * A client may send a single binary byte containing these bits to select the
+ * record types it receives. All types are enabled on connect.
+ */
+#define TELEMETRY_MASK_INPUT  (1 << TELEMETRY_RECORD_INPUT)
+#define TELEMETRY_MASK_OUTPUT (1 << TELEMETRY_RECORD_OUTPUT)
+#define TELEMETRY_MASK_CAN    (1 << TELEMETRY_RECORD_CAN)
+#define TELEMETRY_MASK_ALL    (TELEMETRY_MASK_INPUT | TELEMETRY_MASK_OUTPUT | TELEMETRY_MASK_CAN)
+
+/**
+ * @brief Wire format of a telemetry record (TELEMETRY_RECORD_SIZE bytes)
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;                    /*!< Record type (telemetry_record_type_t) */
+    uint8_t source;                  /*!< Device index, output channel, or CAN DLC | 0x80 if extended */
+    uint16_t time_offset_ms;         /*!< Time relative to the batch base timestamp */
+    union {
+        struct __attribute__((packed)) {
+            uint8_t input_type;      /*!< Input type (input_type_t) */
+            uint8_t input_index;     /*!< Input index */
+            uint16_t reserved;
+            int32_t value;           /*!< Input value */
+            uint32_t reserved2;
+        } input;
+        struct __attribute__((packed)) {
+            uint16_t mapping_idx;    /*!< Mapping that produced the output */
+            uint8_t len;             /*!< Output length in bytes */
+            uint8_t status;          /*!< 0 on success, otherwise failed */
+            uint32_t can_id;         /*!< CAN ID for CAN outputs */
+            uint32_t latency_us;     /*!< Input-to-output latency */
+        } output;
+        struct __attribute__((packed)) {
+            uint32_t id;             /*!< CAN message ID */
+            uint8_t data[8];         /*!< CAN payload */
+        } can;
+    };
+} telemetry_record_t;
+
+/**
+ * @brief Telemetry configuration structure
+ */
+typedef struct {
+    uint32_t tick_ms;                /*!< Batch period (ms); the ring holds one default tick of a busy bus */
+    uint8_t task_priority;           /*!< Priority of the telemetry task (below the real-time path) */
+} telemetry_config_t;
+
+/**
+ * @brief Per-client telemetry statistics
+ */
+typedef struct {
+    bool connected;                  /*!< Slot in use */
+    int fd;                          /*!< Socket descriptor */
+    uint8_t decimation;              /*!< Current decimation factor (1 = every batch) */
+    uint32_t batches_sent;           /*!< Batch frames sent */
+    uint32_t batches_dropped;        /*!< Batch frames skipped due to backpressure */
+    uint32_t records_dropped;        /*!< Records lost to backpressure or producer ring overflow */
+    uint64_t bytes_sent;             /*!< Bytes sent */
+    uint64_t build_time_us;          /*!< Telemetry task time spent filtering and queuing frames for this client */
+    uint64_t send_time_us;           /*!< Wall time in the httpd task sending frames, including time blocked on the socket */
+} telemetry_client_stats_t;
+
+/**
+ * @brief Global telemetry statistics
+ */
+typedef struct {
+    uint32_t records_produced;       /*!< Records written by producers */
+    uint32_t records_overflowed;     /*!< Records lost because the ring was full */
+    uint64_t drain_time_us;          /*!< Time spent draining the ring (shared by all clients) */
+    telemetry_client_stats_t clients[TELEMETRY_MAX_CLIENTS]; /*!< Per-client statistics */
+} telemetry_stats_t;
+
+/**
+ * @brief Initialize telemetry and start the telemetry task
+ *
+ * @param config Pointer to the telemetry configuration
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t telemetry_init(const telemetry_config_t *config);
+
+/**
+ * @brief Register the `/ws/telemetry` endpoint on the web server
+ *
+ * @param server HTTP server handle
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if telemetry_init() did not succeed
+ */
+esp_err_t telemetry_register_handlers(httpd_handle_t server);
+
+/**
+ * @brief Release the telemetry client on a closed socket
+ *
+ * Must be called from the web server's close callback (`close_fn` in
+ * httpd_config_t), which still has to close the socket itself. Without it a
+ * client that disconnects without a WebSocket close frame keeps its slot
+ * until a send fails.
+ *
+ * @param server HTTP server handle
+ * @param fd Socket descriptor being closed
+ */
+void telemetry_on_close(httpd_handle_t server, int fd);
+
+/**
+ * @brief Record an HID input change (non-blocking)
+ *
+ * @param device_idx Device index
+ * @param input_type Input type (input_type_t)
+ * @param input_index Input index
+ * @param value Input value
+ */
+void telemetry_record_input(uint8_t device_idx, uint8_t input_type, uint8_t input_index, int32_t value);
+
+/**
+ * @brief Record an output sent by a mapping (non-blocking)
+ *
+ * @param channel Output channel (0-2 serial ports, 3 CAN)
+ * @param mapping_idx Mapping index
+ * @param can_id CAN message ID (0 for serial outputs)
+ * @param len Output length in bytes
+ * @param status Result of the send
+ * @param latency_us Input-to-output latency
+ */
+void telemetry_record_output(uint8_t channel, uint16_t mapping_idx, uint32_t can_id, uint8_t len,
+                             esp_err_t status, uint32_t latency_us);
+
+/**
+ * @brief Record a CAN frame seen on the bus (non-blocking)
+ *
+ * @param id CAN message ID
+ * @param extended Extended ID flag
+ * @param dlc Data length code
+ * @param data Pointer to the payload (dlc bytes)
+ */
+void telemetry_record_can(uint32_t id, bool extended, uint8_t dlc, const uint8_t *data);
+
+/**
+ * @brief Get telemetry statistics
+ *
+ * @param[out] stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t telemetry_get_stats(telemetry_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,399 @@
+/**
+ * @file mapping_bench.c
+ * @brief Host benchmark of the streaming mapping import against one-by-one POSTs
+ *
+ * Generates a document of MAPPING_JSON_MAX_MAPPINGS mappings (or -n) with the
+ * exporter and installs it both ways a provisioning script can:
+ *
+ * - bulk: one `POST /api/mappings` with the whole array. The body is fed to
+ *   mapping_json_import_feed() in MAPPING_JSON_RECV_CHUNK pieces into a
+ *   staging array taken from the PSRAM arena inside a scratch scope, then
+ *   committed with mapping_replace_all(), like mapping_json_http_import().
+ * - one-by-one: one `POST /api/mappings` per mapping. Each request body (a
+ *   single mapping object) is received whole into a heap buffer, decoded and
+ *   installed with mapping_add().
+ *
+ * For each path the harness prints the requests and bytes sent, the mean
+ * time to decode and install the set, and the peak memory by placement:
+ * internal RAM for receive buffers, request bodies and parser state, and
+ * PSRAM for the staging array (arena high-water mark). HTTP round trips are
+ * not included, so on the device every extra request adds its round trip to
+ * the one-by-one time.
+ *
+ * input_mapping.c needs NVS and the output drivers, so the mapping table is
+ * replaced by a plain array with the same slot semantics.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -DMAPPING_JSON_HOST -DMEM_ARENA_HOST -I. -I$IDF_PATH/components/esp_common/include \
+ *       tools/mapping_bench.c mapping_json.c mem_arena.c -o mapping_bench
+ *
+ * Usage:
+ *   mapping_bench [-n mappings] [-r runs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mapping_json.h"
+#include "mem_arena.h"
+
+#define BENCH_DEFAULT_RUNS 20
+
+typedef struct {
+    const char *name;
+    uint32_t requests;               // Requests needed to install the set
+    size_t bytes;                    // Request body bytes
+    int64_t time_us;                 // Time of all runs
+    size_t internal_peak;            // Peak internal RAM (receive buffers, bodies, parser state)
+    size_t psram_peak;               // Peak PSRAM (arena high-water mark)
+    esp_err_t result;                // Result of the last run
+    const char *error;               // Parser error of the last run, NULL if none
+} bench_result_t;
+
+// Mapping table standing in for input_mapping.c
+static input_mapping_t s_table[MAPPING_JSON_MAX_MAPPINGS];
+static bool s_in_use[MAPPING_JSON_MAX_MAPPINGS];
+
+// Heap used for request bodies by the one-by-one path
+static size_t s_heap_used = 0;
+static size_t s_heap_peak = 0;
+
+esp_err_t mapping_add(const input_mapping_t *mapping, uint16_t *mapping_idx)
+{
+    for (uint16_t i = 0; i < MAPPING_JSON_MAX_MAPPINGS; i++) {
+        if (!s_in_use[i]) {
+            s_table[i] = *mapping;
+            s_in_use[i] = true;
+            if (mapping_idx != NULL) {
+                *mapping_idx = i;
+            }
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t mapping_replace_all(const input_mapping_t *mappings, uint16_t count)
+{
+    if (count > MAPPING_JSON_MAX_MAPPINGS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(s_table, mappings, count * sizeof(*mappings));
+    for (uint16_t i = 0; i < MAPPING_JSON_MAX_MAPPINGS; i++) {
+        s_in_use[i] = i < count;
+    }
+    return ESP_OK;
+}
+
+esp_err_t mapping_get(uint16_t mapping_idx, input_mapping_t *mapping)
+{
+    if (mapping_idx >= MAPPING_JSON_MAX_MAPPINGS || !s_in_use[mapping_idx]) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *mapping = s_table[mapping_idx];
+    return ESP_OK;
+}
+
+static void clear_table(void)
+{
+    memset(s_in_use, 0, sizeof(s_in_use));
+}
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *body_alloc(size_t size)
+{
+    void *p = malloc(size);
+    if (p != NULL) {
+        s_heap_used += size;
+        if (s_heap_used > s_heap_peak) {
+            s_heap_peak = s_heap_used;
+        }
+    }
+    return p;
+}
+
+static void body_free(void *p, size_t size)
+{
+    free(p);
+    s_heap_used -= size;
+}
+
+// A mix of keyboard, mouse and gamepad mappings to serial and CAN outputs
+static void generate_mapping(uint16_t i, input_mapping_t *m)
+{
+    memset(m, 0, sizeof(*m));
+    m->enabled = (i % 7) != 0;
+    m->device_idx = i / MAX_MAPPINGS_PER_DEVICE;
+    m->input_type = (input_type_t)(i % (INPUT_TYPE_GENERIC_REPORT + 1));
+    m->input_index = (uint8_t)(i * 5);
+    m->condition.type = (condition_type_t)(i % (CONDITION_ALWAYS + 1));
+    m->condition.value = i % 3;
+    m->scale_factor = 100 + i;
+    m->offset = -(int32_t)(i % 50);
+    m->min_interval_ms = 10 * (i % 4);
+
+    if (i % 2 == 0) {
+        m->output_type = OUTPUT_TYPE_CANBUS;
+        m->output_config.canbus.port = 0;
+        m->output_config.canbus.bitrate = 500000;
+        m->output_config.canbus.extended_id = (i % 8) == 0;
+        m->can_id = m->output_config.canbus.extended_id ? 0x18FF0000u + i : 0x100u + i;
+        m->can_dlc = 8;
+        m->output_format = FORMAT_RAW;
+    } else {
+        m->output_type = OUTPUT_TYPE_SERIAL;
+        m->output_config.serial.port = i % 3;
+        m->output_config.serial.baud_rate = 115200;
+        m->output_config.serial.data_bits = 8;
+        m->output_config.serial.stop_bits = 1;
+        m->output_format = (i % 3) == 0 ? FORMAT_CUSTOM : FORMAT_DECIMAL;
+        snprintf(m->format_string, sizeof(m->format_string), "IN%u=%%d\r\n", (unsigned)i);
+    }
+    m->output_data_len = 1 + i % 4;
+    for (uint8_t b = 0; b < m->output_data_len; b++) {
+        m->output_data[b] = (uint8_t)(i + b);
+    }
+}
+
+/**
+ * Export a generated set into one document. Each exporter piece holds one
+ * mapping, so the piece offsets also give the one-by-one request bodies.
+ * Counts above MAPPING_JSON_MAX_MAPPINGS repeat the generated mappings.
+ */
+static char *build_document(uint16_t count, size_t *doc_len, size_t **starts, size_t **lens)
+{
+    uint16_t generated = count < MAPPING_JSON_MAX_MAPPINGS ? count : MAPPING_JSON_MAX_MAPPINGS;
+    char piece[MAPPING_JSON_EXPORT_CHUNK];
+    mapping_json_export_t export;
+    size_t len;
+
+    clear_table();
+    for (uint16_t i = 0; i < generated; i++) {
+        input_mapping_t m;
+        generate_mapping(i, &m);
+        mapping_add(&m, NULL);
+    }
+
+    size_t capacity = (size_t)count * MAPPING_JSON_EXPORT_CHUNK + 2;
+    char *doc = malloc(capacity);
+    *starts = malloc(count * sizeof(**starts));
+    *lens = malloc(count * sizeof(**lens));
+    if (doc == NULL || *starts == NULL || *lens == NULL) {
+        return NULL;
+    }
+
+    // Pieces are "[{...}", ",{...}" ... and a final "]"; keep the object part of each
+    size_t n = 0;
+    mapping_json_export_begin(&export);
+    for (uint16_t i = 0; i < generated; i++) {
+        if (mapping_json_export_next(&export, piece, sizeof(piece), &len) != ESP_OK || len < 2) {
+            return NULL;
+        }
+        memcpy(doc + n, piece, len);
+        (*starts)[i] = n + 1;
+        (*lens)[i] = len - 1;
+        n += len;
+    }
+    for (uint16_t i = generated; i < count; i++) {
+        size_t src = (*starts)[i % generated];
+        size_t src_len = (*lens)[i % generated];
+        doc[n++] = ',';
+        memcpy(doc + n, doc + src, src_len);
+        (*starts)[i] = n;
+        (*lens)[i] = src_len;
+        n += src_len;
+    }
+    doc[n++] = ']';
+    *doc_len = n;
+    return doc;
+}
+
+// Same steps as mapping_json_http_import(), with the socket replaced by the document
+static esp_err_t import_bulk(const char *doc, size_t doc_len, const char **error)
+{
+    static mapping_json_import_t s_import;
+    char buf[MAPPING_JSON_RECV_CHUNK];
+    input_mapping_t *staging = NULL;
+    size_t mark;
+
+    if (mem_arena_scratch_begin(MEM_ARENA_BULK, &mark) == ESP_OK) {
+        staging = mem_arena_alloc(MEM_ARENA_BULK, MAPPING_JSON_MAX_MAPPINGS * sizeof(input_mapping_t), "bench");
+        if (staging == NULL) {
+            mem_arena_scratch_end(MEM_ARENA_BULK, mark);
+        }
+    }
+    if (staging == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    mapping_json_import_begin(&s_import, staging, MAPPING_JSON_MAX_MAPPINGS);
+
+    esp_err_t ret = ESP_OK;
+    for (size_t offset = 0; offset < doc_len && ret == ESP_OK; offset += sizeof(buf)) {
+        size_t received = doc_len - offset < sizeof(buf) ? doc_len - offset : sizeof(buf);
+        memcpy(buf, doc + offset, received);
+        ret = mapping_json_import_feed(&s_import, buf, received);
+    }
+    if (ret == ESP_OK) {
+        ret = mapping_json_import_commit(&s_import);
+    }
+    mem_arena_scratch_end(MEM_ARENA_BULK, mark);
+
+    *error = s_import.error;
+    return ret;
+}
+
+// One request per mapping: the body is received whole, decoded and added
+static esp_err_t import_one_by_one(const char *doc, const size_t *starts, const size_t *lens, uint16_t count,
+                                   const char **error)
+{
+    static mapping_json_import_t s_import;
+    input_mapping_t mapping;
+
+    clear_table();
+    for (uint16_t i = 0; i < count; i++) {
+        size_t content_len = lens[i];
+        char *body = body_alloc(content_len);
+        if (body == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        for (size_t offset = 0; offset < content_len; offset += MAPPING_JSON_RECV_CHUNK) {
+            size_t received = content_len - offset < MAPPING_JSON_RECV_CHUNK ? content_len - offset
+                                                                              : MAPPING_JSON_RECV_CHUNK;
+            memcpy(body + offset, doc + starts[i] + offset, received);
+        }
+
+        mapping_json_import_begin(&s_import, &mapping, 1);
+        esp_err_t ret = mapping_json_import_feed(&s_import, "[", 1);
+        if (ret == ESP_OK) {
+            ret = mapping_json_import_feed(&s_import, body, content_len);
+        }
+        if (ret == ESP_OK) {
+            ret = mapping_json_import_feed(&s_import, "]", 1);
+        }
+        body_free(body, content_len);
+        if (ret == ESP_OK && !s_import.done) {
+            ret = ESP_ERR_INVALID_STATE;
+        }
+        if (ret == ESP_OK) {
+            ret = mapping_add(&mapping, NULL);
+        }
+        if (ret != ESP_OK) {
+            *error = s_import.error ? s_import.error : (ret == ESP_ERR_NO_MEM ? "mapping table full" : NULL);
+            return ret;
+        }
+    }
+    *error = NULL;
+    return ESP_OK;
+}
+
+static size_t bulk_psram_high_water(void)
+{
+    mem_arena_stats_t stats;
+    return mem_arena_get_stats(MEM_ARENA_BULK, &stats) == ESP_OK ? stats.high_water : 0;
+}
+
+static void print_result(const bench_result_t *r, uint16_t count, uint32_t runs)
+{
+    double per_run = (double)r->time_us / runs;
+    printf("%-11s %8u %8u %10.1f %9.2f %10u %8u  ", r->name, (unsigned)r->requests, (unsigned)r->bytes,
+           per_run, per_run / count, (unsigned)r->internal_peak, (unsigned)r->psram_peak);
+    if (r->result == ESP_OK) {
+        printf("ok\n");
+    } else {
+        printf("failed (%d%s%s)\n", r->result, r->error ? ": " : "", r->error ? r->error : "");
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-n mappings] [-r runs]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long count = MAPPING_JSON_MAX_MAPPINGS;
+    uint32_t runs = BENCH_DEFAULT_RUNS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            runs = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind != argc || count == 0 || count > UINT16_MAX || runs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (mem_arena_init() != ESP_OK) {
+        fprintf(stderr, "Failed to initialize arenas\n");
+        return 1;
+    }
+
+    size_t doc_len;
+    size_t *starts;
+    size_t *lens;
+    char *doc = build_document((uint16_t)count, &doc_len, &starts, &lens);
+    if (doc == NULL) {
+        fprintf(stderr, "Failed to generate the document\n");
+        return 1;
+    }
+
+    bench_result_t bulk = { .name = "bulk", .requests = 1, .bytes = doc_len };
+    size_t psram_before = bulk_psram_high_water();
+    int64_t start = now_us();
+    for (uint32_t i = 0; i < runs; i++) {
+        bulk.result = import_bulk(doc, doc_len, &bulk.error);
+    }
+    bulk.time_us = now_us() - start;
+    bulk.psram_peak = bulk_psram_high_water() - psram_before;
+    bulk.internal_peak = MAPPING_JSON_RECV_CHUNK + sizeof(mapping_json_import_t);
+
+    bench_result_t single = { .name = "one-by-one", .requests = (uint32_t)count };
+    size_t max_body = 0;
+    for (unsigned long i = 0; i < count; i++) {
+        single.bytes += lens[i];
+        if (lens[i] > max_body) {
+            max_body = lens[i];
+        }
+    }
+    start = now_us();
+    for (uint32_t i = 0; i < runs; i++) {
+        single.result = import_one_by_one(doc, starts, lens, (uint16_t)count, &single.error);
+    }
+    single.time_us = now_us() - start;
+    single.internal_peak = s_heap_peak + sizeof(mapping_json_import_t) + sizeof(input_mapping_t);
+
+    printf("%lu mappings (limit %u), %u runs, %u byte receive chunks, largest mapping %u bytes\n\n",
+           count, (unsigned)MAPPING_JSON_MAX_MAPPINGS, (unsigned)runs, (unsigned)MAPPING_JSON_RECV_CHUNK,
+           (unsigned)max_body);
+    printf("%-11s %8s %8s %10s %9s %10s %8s  %s\n", "path", "requests", "bytes", "us/run", "us/map",
+           "internal", "psram", "result");
+    print_result(&bulk, (uint16_t)count, runs);
+    print_result(&single, (uint16_t)count, runs);
+
+    free(doc);
+    free(starts);
+    free(lens);
+    return 0;
+}
@@ -0,0 +1,417 @@
+/**
+ * @file ota_replay.c
+ * @brief Host harness measuring the output latency impact of a streaming OTA update
+ *
+ * Replays HID input traffic through a simulated HID-to-output pipeline twice:
+ * once on its own, and once while a firmware image is streamed through
+ * ota_stream_* built with OTA_STREAM_HOST (chunks go to a regular file instead
+ * of the OTA partition). The input-to-output latency of every event is
+ * recorded, and the p50/p99/max of both runs are printed side by side with
+ * the update statistics.
+ *
+ * The pipeline models what an update costs on the device. Each chunk write
+ * holds the simulated flash for -w microseconds (sector erase and program),
+ * and the pipeline cannot process an event while the flash is held, like code
+ * running from cache while the cache is disabled. Processing an event takes
+ * -p microseconds. The pipeline's running average latency is fed back to the
+ * writer through latency_fn, standing in for latency_avg_us of the TunerStudio
+ * realtime snapshot, so the pacing loop is closed like on the device.
+ *
+ * HID traffic is either generated at a fixed rate (-r, a USB poll interval by
+ * default) or replayed from a text trace with one input event per line, time
+ * in milliseconds first (for example the time_ms of the input records of a
+ * /ws/telemetry capture). Other columns and lines starting with '#' are
+ * ignored, and the trace is looped until each run is over.
+ *
+ * Build (from the repository root):
+ *   gcc -DOTA_STREAM_HOST -DMEM_ARENA_HOST -I. -I$IDF_PATH/components/esp_common/include \
+ *       tools/ota_replay.c ota_stream.c mem_arena.c \
+ *       $IDF_PATH/components/esp_common/src/esp_err_to_name.c -lmbedcrypto -lpthread -o ota_replay
+ *
+ * Usage:
+ *   ota_replay [-b budget_us] [-m min_ms] [-M max_ms] [-w flash_us] [-p process_us]
+ *              [-r rate_hz] [-d idle_ms] [-o out.bin] image.bin [hid_trace.txt]
+ *     hid_trace.txt may be '-' to read the trace from stdin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "ota_stream.h"
+#include "mem_arena.h"
+
+// Size of each write, roughly one TCP segment as the HTTP upload receives it
+#define REPLAY_WRITE_SIZE 1436
+
+// Typical erase and program time of one 4 KB sector on the module flash
+#define REPLAY_DEFAULT_FLASH_US 30000
+
+// Mapping lookup and output send per event on the device
+#define REPLAY_DEFAULT_PROCESS_US 50
+
+// One event per USB full-speed poll interval
+#define REPLAY_DEFAULT_RATE_HZ 1000
+
+// Length of the run without an update
+#define REPLAY_DEFAULT_IDLE_MS 5000
+
+// Weight of a new sample in the running average fed to the writer (1/8)
+#define REPLAY_AVG_SHIFT 3
+
+typedef struct {
+    uint64_t *samples;               // Latency of each processed event (us)
+    size_t count;
+    size_t capacity;
+} latency_run_t;
+
+static uint32_t s_flash_us = REPLAY_DEFAULT_FLASH_US;
+static uint32_t s_process_us = REPLAY_DEFAULT_PROCESS_US;
+
+// Input event times in microseconds from the start of the trace, and its loop period
+static uint64_t *s_events = NULL;
+static size_t s_event_count = 0;
+static uint64_t s_trace_period_us = 0;
+
+// Held by the writer while the simulated flash is busy, and by the pipeline while it runs
+static pthread_mutex_t s_flash = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_uint s_latency_avg_us = 0;
+static atomic_bool s_stop = false;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_until_us(int64_t deadline)
+{
+    struct timespec ts = {
+        .tv_sec = deadline / 1000000,
+        .tv_nsec = (deadline % 1000000) * 1000,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+    }
+}
+
+static int add_event(uint64_t time_us, size_t *capacity)
+{
+    if (s_event_count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 1024;
+        uint64_t *grown = realloc(s_events, *capacity * sizeof(*s_events));
+        if (grown == NULL) {
+            return -1;
+        }
+        s_events = grown;
+    }
+    s_events[s_event_count++] = time_us;
+    return 0;
+}
+
+static int load_events(FILE *file)
+{
+    size_t capacity = 0;
+    char line[128];
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        double time_ms;
+        if (line[0] == '#' || sscanf(line, "%lf", &time_ms) != 1 || time_ms < 0) {
+            continue;
+        }
+        if (add_event((uint64_t)(time_ms * 1000), &capacity) != 0) {
+            return -1;
+        }
+    }
+    if (s_event_count == 0) {
+        return -1;
+    }
+    // Loop with the trace's own mean spacing after the last event
+    uint64_t span = s_events[s_event_count - 1] - s_events[0];
+    s_trace_period_us = span + (s_event_count > 1 ? span / (s_event_count - 1) : 1000);
+    return 0;
+}
+
+static int generate_events(uint32_t rate_hz)
+{
+    size_t capacity = 0;
+
+    if (add_event(0, &capacity) != 0) {
+        return -1;
+    }
+    s_trace_period_us = 1000000 / rate_hz;
+    return 0;
+}
+
+// Time of the nth event of the looped trace, relative to the start of a run
+static uint64_t event_time_us(size_t n)
+{
+    uint64_t loop = n / s_event_count;
+    return loop * s_trace_period_us + (s_events[n % s_event_count] - s_events[0]);
+}
+
+static void record_latency(latency_run_t *run, uint64_t latency_us)
+{
+    if (run->count == run->capacity) {
+        run->capacity = run->capacity ? run->capacity * 2 : 4096;
+        uint64_t *grown = realloc(run->samples, run->capacity * sizeof(*run->samples));
+        if (grown == NULL) {
+            return;
+        }
+        run->samples = grown;
+    }
+    run->samples[run->count++] = latency_us;
+
+    unsigned avg = atomic_load(&s_latency_avg_us);
+    avg = avg - (avg >> REPLAY_AVG_SHIFT) + (unsigned)(latency_us >> REPLAY_AVG_SHIFT);
+    atomic_store(&s_latency_avg_us, avg);
+}
+
+// Replay the input events and process each one, until s_stop is set
+static void *pipeline_task(void *arg)
+{
+    latency_run_t *run = (latency_run_t *)arg;
+    int64_t start = now_us();
+
+    for (size_t n = 0; !atomic_load(&s_stop); n++) {
+        int64_t input_us = start + (int64_t)event_time_us(n);
+        sleep_until_us(input_us);
+
+        pthread_mutex_lock(&s_flash);
+        int64_t done = now_us() + s_process_us;
+        while (now_us() < done) {
+        }
+        pthread_mutex_unlock(&s_flash);
+
+        record_latency(run, (uint64_t)(now_us() - input_us));
+    }
+    return NULL;
+}
+
+// latency_fn: the running average, like latency_avg_us of the realtime snapshot
+static uint32_t pipeline_latency(void)
+{
+    return atomic_load(&s_latency_avg_us);
+}
+
+// progress_cb: runs after each chunk write and holds the flash for the time the file write lacks
+static void simulate_flash(size_t written, size_t total, void *user_ctx)
+{
+    if (s_flash_us != 0) {
+        pthread_mutex_lock(&s_flash);
+        usleep(s_flash_us);
+        pthread_mutex_unlock(&s_flash);
+    }
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const latency_run_t *run, unsigned pct)
+{
+    if (run->count == 0) {
+        return 0;
+    }
+    size_t idx = (run->count * pct + 99) / 100;
+    return run->samples[idx > 0 ? idx - 1 : 0];
+}
+
+static void print_run(const char *name, latency_run_t *run)
+{
+    qsort(run->samples, run->count, sizeof(*run->samples), compare_u64);
+    printf("%-10s %8u %8llu %8llu %8llu\n", name, (unsigned)run->count,
+           (unsigned long long)percentile(run, 50), (unsigned long long)percentile(run, 99),
+           (unsigned long long)(run->count ? run->samples[run->count - 1] : 0));
+}
+
+static int start_pipeline(pthread_t *thread, latency_run_t *run)
+{
+    atomic_store(&s_stop, false);
+    atomic_store(&s_latency_avg_us, 0);
+    return pthread_create(thread, NULL, pipeline_task, run);
+}
+
+static void stop_pipeline(pthread_t thread)
+{
+    atomic_store(&s_stop, true);
+    pthread_join(thread, NULL);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-b budget_us] [-m min_ms] [-M max_ms] [-w flash_us] [-p process_us] "
+            "[-r rate_hz] [-d idle_ms] [-o out.bin] image.bin [hid_trace.txt]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    ota_stream_config_t config = {
+        .latency_budget_us = 2000,
+        .min_chunk_interval_ms = 0,
+        .max_chunk_interval_ms = 200,
+        .latency_fn = pipeline_latency,
+        .progress_cb = simulate_flash,
+        .host_path = "ota_replay.bin",
+    };
+    uint32_t rate_hz = REPLAY_DEFAULT_RATE_HZ;
+    uint32_t idle_ms = REPLAY_DEFAULT_IDLE_MS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:m:M:w:p:r:d:o:")) != -1) {
+        switch (opt) {
+        case 'b':
+            config.latency_budget_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            config.min_chunk_interval_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'M':
+            config.max_chunk_interval_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            s_flash_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            s_process_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            rate_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            idle_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            config.host_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind < 1 || argc - optind > 2 || rate_hz == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *image = fopen(argv[optind], "rb");
+    if (image == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    fseek(image, 0, SEEK_END);
+    size_t image_size = (size_t)ftell(image);
+    fseek(image, 0, SEEK_SET);
+
+    if (argc - optind == 2) {
+        const char *path = argv[optind + 1];
+        FILE *trace = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+        if (trace == NULL) {
+            perror(path);
+            return 1;
+        }
+        if (load_events(trace) != 0) {
+            fprintf(stderr, "%s: no input events\n", path);
+            return 1;
+        }
+        if (trace != stdin) {
+            fclose(trace);
+        }
+    } else if (generate_events(rate_hz) != 0) {
+        return 1;
+    }
+
+    if (mem_arena_init() != ESP_OK) {
+        fprintf(stderr, "Failed to initialize arenas\n");
+        return 1;
+    }
+
+    // Run 1: the pipeline on its own
+    latency_run_t idle = { 0 };
+    pthread_t pipeline;
+    if (start_pipeline(&pipeline, &idle) != 0) {
+        fprintf(stderr, "Failed to start the pipeline\n");
+        return 1;
+    }
+    usleep(idle_ms * 1000);
+    stop_pipeline(pipeline);
+
+    // Run 2: the same traffic while the image is streamed through the paced writer
+    latency_run_t update = { 0 };
+    if (start_pipeline(&pipeline, &update) != 0) {
+        fprintf(stderr, "Failed to start the pipeline\n");
+        return 1;
+    }
+
+    ota_stream_t *stream;
+    int64_t start_us = now_us();
+    if (ota_stream_begin(&config, image_size, NULL, &stream) != ESP_OK) {
+        stop_pipeline(pipeline);
+        fprintf(stderr, "Failed to start update\n");
+        return 1;
+    }
+
+    uint8_t buf[REPLAY_WRITE_SIZE];
+    size_t read;
+    while ((read = fread(buf, 1, sizeof(buf), image)) > 0) {
+        if (ota_stream_write(stream, buf, read) != ESP_OK) {
+            ota_stream_abort(stream);
+            stop_pipeline(pipeline);
+            fprintf(stderr, "Write failed\n");
+            return 1;
+        }
+    }
+    fclose(image);
+
+    uint8_t sha256[OTA_STREAM_SHA256_SIZE];
+    esp_err_t ret = ota_stream_finish(stream, sha256);
+    int64_t elapsed_us = now_us() - start_us;
+    stop_pipeline(pipeline);
+    if (ret != ESP_OK) {
+        fprintf(stderr, "Finish failed\n");
+        return 1;
+    }
+
+    ota_stream_stats_t stats;
+    ota_stream_get_stats(&stats);
+
+    printf("image            %u bytes -> %s\n", (unsigned)stats.bytes_written, config.host_path);
+    printf("sha256           ");
+    for (int i = 0; i < OTA_STREAM_SHA256_SIZE; i++) {
+        printf("%02x", sha256[i]);
+    }
+    printf("\n");
+    printf("duration         %.3f s\n", elapsed_us / 1e6);
+    printf("chunks           %u written, %u throttled\n",
+           (unsigned)stats.chunks_written, (unsigned)stats.chunks_throttled);
+    printf("throttle time    %u ms\n", (unsigned)stats.throttle_time_ms);
+    printf("write time max   %u us (plus %u us simulated flash per chunk)\n",
+           (unsigned)stats.write_time_max_us, (unsigned)s_flash_us);
+    printf("latency avg max  %u us (budget %u us)\n",
+           (unsigned)stats.latency_max_us, (unsigned)config.latency_budget_us);
+    printf("\n");
+    printf("output latency   %8s %8s %8s %8s\n", "events", "p50 us", "p99 us", "max us");
+    printf("       ");
+    print_run("idle", &idle);
+    printf("       ");
+    print_run("update", &update);
+    printf("impact           p50 %+lld us, p99 %+lld us\n",
+           (long long)percentile(&update, 50) - (long long)percentile(&idle, 50),
+           (long long)percentile(&update, 99) - (long long)percentile(&idle, 99));
+    mem_arena_log_stats();
+
+    free(idle.samples);
+    free(update.samples);
+    free(s_events);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file trace_decode.c
+ * @brief Host decoder for binary trace dumps
+ *
+ * Turns a trace dump (trace_dump_header_t followed by trace_record_t
+ * records) into readable text and a per-format timeline summary, using the
+ * same trace_formats.def table as the firmware. Records of both cores are
+ * merged on their shared microsecond time base; the per-core cycle count is
+ * printed alongside for finer intervals within one core.
+ *
+ * Build (from the repository root):
+ *   gcc -I. -I$IDF_PATH/components/esp_common/include tools/trace_decode.c -o trace_decode
+ *
+ * Usage:
+ *   trace_decode [-t] dump.bin
+ *     -t  print only the timeline summary
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_HOST
+#include "trace.h"
+
+typedef struct {
+    trace_record_t record;
+    uint64_t time_us;                // Unwrapped microsecond time
+} decoded_record_t;
+
+typedef struct {
+    uint32_t count;
+    double first_us;
+    double last_us;
+    double min_interval_us;
+    double max_interval_us;
+} format_summary_t;
+
+static const char *const s_formats[TRACE_FORMAT_COUNT] = {
+#define TRACE_FORMAT(name, category, format) [name] = format,
+#include "trace_formats.def"
+#undef TRACE_FORMAT
+};
+
+static const char *const s_names[TRACE_FORMAT_COUNT] = {
+#define TRACE_FORMAT(name, category, format) [name] = #name,
+#include "trace_formats.def"
+#undef TRACE_FORMAT
+};
+
+static int compare_seq(const void *a, const void *b)
+{
+    const decoded_record_t *ra = a;
+    const decoded_record_t *rb = b;
+    if (ra->record.core != rb->record.core) {
+        return ra->record.core - rb->record.core;
+    }
+    return (int32_t)(ra->record.seq - rb->record.seq) < 0 ? -1 : 1;
+}
+
+static int compare_time(const void *a, const void *b)
+{
+    const decoded_record_t *ra = a;
+    const decoded_record_t *rb = b;
+    if (ra->time_us != rb->time_us) {
+        return ra->time_us < rb->time_us ? -1 : 1;
+    }
+    // Same microsecond: keep each core in sequence order
+    return compare_seq(a, b);
+}
+
+// Extend the 32-bit microsecond times to 64 bits. The time base is shared by
+// both cores, so all records are unwrapped against one reference: the first
+// record of each core in sequence order is placed relative to the first
+// record of the dump, and later ones step forward by the wrapped difference.
+// Gaps longer than one period (about 71 minutes) cannot be detected.
+static void unwrap_timestamps(decoded_record_t *records, size_t count)
+{
+    qsort(records, count, sizeof(*records), compare_seq);
+
+    uint32_t reference = 0;
+    bool have_reference = false;
+    for (size_t i = 0; i < count; i++) {
+        if (!have_reference || (int32_t)(records[i].record.time_us - reference) < 0) {
+            reference = records[i].record.time_us;
+            have_reference = true;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (i == 0 || records[i].record.core != records[i - 1].record.core) {
+            records[i].time_us = (uint32_t)(records[i].record.time_us - reference);
+        } else {
+            uint32_t delta = records[i].record.time_us - records[i - 1].record.time_us;
+            records[i].time_us = records[i - 1].time_us + delta;
+        }
+    }
+
+    qsort(records, count, sizeof(*records), compare_time);
+}
+
+static void format_record(const trace_record_t *record, char *buf, size_t size)
+{
+    if (record->format_id >= TRACE_FORMAT_COUNT) {
+        snprintf(buf, size, "unknown format %u", record->format_id);
+        return;
+    }
+    snprintf(buf, size, s_formats[record->format_id],
+             record->args[0], record->args[1], record->args[2], record->args[3]);
+}
+
+int main(int argc, char **argv)
+{
+    bool timeline_only = false;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0) {
+            timeline_only = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s [-t] dump.bin\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    trace_dump_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_DUMP_MAGIC) {
+        fprintf(stderr, "%s: not a trace dump\n", path);
+        fclose(file);
+        return 1;
+    }
+    if (header.version != TRACE_DUMP_VERSION || header.record_size != sizeof(trace_record_t)) {
+        fprintf(stderr, "%s: unsupported dump version %u (record size %u)\n",
+                path, header.version, header.record_size);
+        fclose(file);
+        return 1;
+    }
+    if (header.format_count != TRACE_FORMAT_COUNT) {
+        fprintf(stderr, "warning: dump has %u formats, decoder has %d; use the matching trace_formats.def\n",
+                header.format_count, TRACE_FORMAT_COUNT);
+    }
+
+    decoded_record_t *records = calloc(header.record_count ? header.record_count : 1, sizeof(*records));
+    if (records == NULL) {
+        fclose(file);
+        return 1;
+    }
+
+    size_t count = 0;
+    while (count < header.record_count && fread(&records[count].record, sizeof(trace_record_t), 1, file) == 1) {
+        count++;
+    }
+    fclose(file);
+    if (count < header.record_count) {
+        fprintf(stderr, "warning: dump truncated, %zu of %u records\n", count, header.record_count);
+    }
+
+    unwrap_timestamps(records, count);
+
+    uint64_t origin = count ? records[0].time_us : 0;
+    format_summary_t summary[TRACE_FORMAT_COUNT];
+    memset(summary, 0, sizeof(summary));
+
+    if (!timeline_only) {
+        printf("%14s %4s %12s %10s  %s\n", "time_us", "core", "delta_us", "cycles", "event");
+    }
+
+    double prev_us = 0;
+    char text[160];
+    for (size_t i = 0; i < count; i++) {
+        const trace_record_t *record = &records[i].record;
+        double time_us = (double)(records[i].time_us - origin);
+
+        if (record->format_id < TRACE_FORMAT_COUNT) {
+            format_summary_t *s = &summary[record->format_id];
+            if (s->count > 0) {
+                double interval = time_us - s->last_us;
+                if (s->count == 1 || interval < s->min_interval_us) {
+                    s->min_interval_us = interval;
+                }
+                if (interval > s->max_interval_us) {
+                    s->max_interval_us = interval;
+                }
+            } else {
+                s->first_us = time_us;
+            }
+            s->last_us = time_us;
+            s->count++;
+        }
+
+        if (!timeline_only) {
+            format_record(record, text, sizeof(text));
+            printf("%14.0f %4u %12.0f %10lu  %s\n", time_us, record->core, time_us - prev_us,
+                   (unsigned long)record->timestamp, text);
+        }
+        prev_us = time_us;
+    }
+
+    printf("\n%zu records, %u lost\n\n", count, header.lost);
+    printf("%-24s %8s %14s %14s %14s %14s %14s\n", "format", "count", "first_us", "last_us",
+           "min_int_us", "avg_int_us", "max_int_us");
+    for (int f = 0; f < TRACE_FORMAT_COUNT; f++) {
+        const format_summary_t *s = &summary[f];
+        if (s->count == 0) {
+            continue;
+        }
+        double avg = s->count > 1 ? (s->last_us - s->first_us) / (s->count - 1) : 0;
+        printf("%-24s %8u %14.3f %14.3f %14.3f %14.3f %14.3f\n", s_names[f], s->count, s->first_us,
+               s->last_us, s->min_interval_us, avg, s->max_interval_us);
+    }
+
+    free(records);
+    return 0;
+}
@@ -0,0 +1,378 @@
+/**
+ * @file trace.c
+ * @brief Deferred binary trace logging implementation
+ *
+ * Each core has its own ring so writers on different cores never share a
+ * cache line. A writer reserves a slot with a single atomic increment and
+ * marks it committed by storing its sequence number, so writers never wait
+ * for each other or for the reader; when the reader falls behind the oldest
+ * records are overwritten and counted as lost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "trace.h"
+#include "mem_arena.h"
+
+static const char *TAG = "trace";
+
+// Records drained per iteration of the log task
+#define TRACE_LOG_BATCH 32
+
+// A dump takes everything the rings can hold
+#define TRACE_DUMP_MAX_RECORDS (TRACE_NUM_CORES * TRACE_RING_SIZE)
+
+typedef struct {
+    atomic_uint head;                // Next sequence number to reserve
+    uint32_t tail;                   // Next sequence number to read (reader only)
+    trace_record_t slots[TRACE_RING_SIZE];
+} trace_ring_t;
+
+volatile uint32_t trace_category_mask = 0;
+
+// Rings live in the internal arena: trace_write() is IRAM code and may run while the flash cache (and PSRAM) is disabled
+static trace_ring_t *s_rings = NULL;
+static uint32_t s_lost = 0;
+static TaskHandle_t s_log_task = NULL;
+static uint32_t s_log_period_ms = 0;
+
+// Serializes readers: a dump holds it for its whole run so the log task cannot take records from it
+static SemaphoreHandle_t s_drain_mutex = NULL;
+
+typedef esp_err_t (*dump_write_fn_t)(void *ctx, const void *data, size_t len);
+
+static const char *const s_formats[TRACE_FORMAT_COUNT] = {
+#define TRACE_FORMAT(name, category, format) [name] = format,
+#include "trace_formats.def"
+#undef TRACE_FORMAT
+};
+
+void IRAM_ATTR trace_write(uint16_t format_id, uint8_t nargs, const uint32_t *args)
+{
+    uint8_t core = (uint8_t)esp_cpu_get_core_id();
+    trace_ring_t *ring = &s_rings[core];
+
+    uint32_t seq = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+    trace_record_t *slot = &ring->slots[seq & (TRACE_RING_SIZE - 1)];
+
+    // Mark the slot as being written before touching its contents
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    atomic_thread_fence(memory_order_release);
+
+    slot->timestamp = esp_cpu_get_cycle_count();
+    // The cycle counters of the two cores are neither synchronized nor long-lived
+    // (they wrap every ~18 s), so records are ordered across cores on esp_timer
+    // time, which is IRAM-safe and common to both cores
+    slot->time_us = (uint32_t)esp_timer_get_time();
+    slot->format_id = format_id;
+    slot->core = core;
+    slot->nargs = nargs;
+    for (uint8_t i = 0; i < TRACE_MAX_ARGS; i++) {
+        slot->args[i] = i < nargs ? args[i] : 0;
+    }
+
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+esp_err_t trace_init(uint32_t categories)
+{
+    if (s_rings == NULL) {
+        s_drain_mutex = xSemaphoreCreateMutex();
+        s_rings = mem_arena_alloc(MEM_ARENA_HOT, TRACE_NUM_CORES * sizeof(trace_ring_t), TAG);
+        if (s_rings == NULL || s_drain_mutex == NULL) {
+            s_rings = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    memset(s_rings, 0, TRACE_NUM_CORES * sizeof(trace_ring_t));
+    s_lost = 0;
+    trace_category_mask = categories;
+
+    TRACE(TRACE_BOOT, categories);
+    ESP_LOGI(TAG, "Trace initialized (categories 0x%08lx, %d formats)",
+             (unsigned long)categories, TRACE_FORMAT_COUNT);
+    return ESP_OK;
+}
+
+void trace_set_categories(uint32_t categories)
+{
+    // Nothing may be recorded before the rings exist
+    if (s_rings == NULL) {
+        return;
+    }
+    trace_category_mask = categories;
+}
+
+uint32_t trace_get_categories(void)
+{
+    return trace_category_mask;
+}
+
+static size_t ring_drain(trace_ring_t *ring, trace_record_t *out, size_t max)
+{
+    size_t count = 0;
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    // Records older than one ring length have been overwritten
+    if (head - ring->tail > TRACE_RING_SIZE) {
+        s_lost += head - ring->tail - TRACE_RING_SIZE;
+        ring->tail = head - TRACE_RING_SIZE;
+    }
+
+    while (ring->tail != head && count < max) {
+        trace_record_t *slot = &ring->slots[ring->tail & (TRACE_RING_SIZE - 1)];
+        uint32_t expected = ring->tail + 1;
+
+        uint32_t seq_before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq_before != expected) {
+            if (seq_before == 0 || (int32_t)(seq_before - expected) < 0) {
+                // Reserved but not committed yet; pick it up next time
+                break;
+            }
+            // Overwritten by a newer record
+            s_lost++;
+            ring->tail++;
+            continue;
+        }
+
+        out[count] = *slot;
+        atomic_thread_fence(memory_order_acquire);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq_before) {
+            s_lost++;
+        } else {
+            count++;
+        }
+        ring->tail++;
+    }
+
+    return count;
+}
+
+// Must be called with s_drain_mutex held
+static size_t drain_locked(trace_record_t *records, size_t max_records)
+{
+    size_t total = 0;
+    for (int core = 0; core < TRACE_NUM_CORES && total < max_records; core++) {
+        total += ring_drain(&s_rings[core], &records[total], max_records - total);
+    }
+    return total;
+}
+
+esp_err_t trace_drain(trace_record_t *records, size_t max_records, size_t *count)
+{
+    if (records == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_rings == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_drain_mutex, portMAX_DELAY);
+    *count = drain_locked(records, max_records);
+    xSemaphoreGive(s_drain_mutex);
+    return ESP_OK;
+}
+
+void trace_fill_dump_header(trace_dump_header_t *header, uint32_t record_count)
+{
+    memset(header, 0, sizeof(*header));
+    header->magic = TRACE_DUMP_MAGIC;
+    header->version = TRACE_DUMP_VERSION;
+    header->record_size = sizeof(trace_record_t);
+    header->cpu_freq_hz = esp_rom_get_cpu_ticks_per_us() * 1000000;
+    header->format_count = TRACE_FORMAT_COUNT;
+    header->record_count = record_count;
+    header->lost = s_lost;
+}
+
+int trace_format_record(const trace_record_t *record, char *buf, size_t size)
+{
+    if (record->format_id >= TRACE_FORMAT_COUNT) {
+        return snprintf(buf, size, "unknown format %u", record->format_id);
+    }
+    return snprintf(buf, size, s_formats[record->format_id],
+                    record->args[0], record->args[1], record->args[2], record->args[3]);
+}
+
+// Drain everything recorded so far and write it out as a dump
+static esp_err_t dump_with(dump_write_fn_t write_fn, void *ctx)
+{
+    trace_record_t *records = NULL;
+    size_t mark;
+
+    if (s_rings == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The records are only needed while they are written out, so they come from a PSRAM scratch scope
+    if (mem_arena_scratch_begin(MEM_ARENA_BULK, &mark) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    records = mem_arena_alloc(MEM_ARENA_BULK, TRACE_DUMP_MAX_RECORDS * sizeof(trace_record_t), TAG);
+    if (records == NULL) {
+        mem_arena_scratch_end(MEM_ARENA_BULK, mark);
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_drain_mutex, portMAX_DELAY);
+    size_t count = drain_locked(records, TRACE_DUMP_MAX_RECORDS);
+
+    trace_dump_header_t header;
+    trace_fill_dump_header(&header, count);
+    esp_err_t ret = write_fn(ctx, &header, sizeof(header));
+    if (ret == ESP_OK && count > 0) {
+        ret = write_fn(ctx, records, count * sizeof(trace_record_t));
+    }
+    xSemaphoreGive(s_drain_mutex);
+
+    mem_arena_scratch_end(MEM_ARENA_BULK, mark);
+    ESP_LOGI(TAG, "Trace dump of %u records (%lu lost) %s", (unsigned)count,
+             (unsigned long)header.lost, ret == ESP_OK ? "written" : "failed");
+    return ret;
+}
+
+static esp_err_t fd_write(void *ctx, const void *data, size_t len)
+{
+    int fd = *(const int *)ctx;
+    const uint8_t *p = data;
+
+    while (len > 0) {
+        ssize_t written = write(fd, p, len);
+        if (written <= 0) {
+            return ESP_FAIL;
+        }
+        p += written;
+        len -= written;
+    }
+    return ESP_OK;
+}
+
+esp_err_t trace_dump_to(int fd)
+{
+    if (fd < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return dump_with(fd_write, &fd);
+}
+
+static esp_err_t http_write(void *ctx, const void *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+// GET /api/trace/dump - binary dump for tools/trace_decode
+static esp_err_t dump_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.bin\"");
+
+    esp_err_t ret = dump_with(http_write, req);
+    if (ret == ESP_ERR_NO_MEM || ret == ESP_ERR_INVALID_STATE) {
+        // Nothing has been sent yet
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Trace dump unavailable");
+        return ret;
+    }
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// POST /api/trace/categories?mask=N - switch categories (GET returns the current mask)
+static esp_err_t categories_handler(httpd_req_t *req)
+{
+    char query[32];
+    char value[16];
+    char resp[48];
+
+    if (req->method == HTTP_POST) {
+        char *end;
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+            httpd_query_key_value(query, "mask", value, sizeof(value)) != ESP_OK) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing mask");
+            return ESP_FAIL;
+        }
+        unsigned long mask = strtoul(value, &end, 0);
+        if (end == value || *end != '\0') {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid mask");
+            return ESP_FAIL;
+        }
+        trace_set_categories((uint32_t)mask);
+    }
+
+    int len = snprintf(resp, sizeof(resp), "{\"categories\":%lu}", (unsigned long)trace_get_categories());
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, resp, len);
+}
+
+esp_err_t trace_register_handlers(httpd_handle_t server)
+{
+    if (server == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const httpd_uri_t uris[] = {
+        { .uri = "/api/trace/dump", .method = HTTP_GET, .handler = dump_get_handler },
+        { .uri = "/api/trace/categories", .method = HTTP_GET, .handler = categories_handler },
+        { .uri = "/api/trace/categories", .method = HTTP_POST, .handler = categories_handler },
+    };
+
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        esp_err_t ret = httpd_register_uri_handler(server, &uris[i]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register %s (%s)", uris[i].uri, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+static void trace_log_task(void *arg)
+{
+    static trace_record_t records[TRACE_LOG_BATCH];
+    char text[128];
+
+    while (1) {
+        size_t count = 0;
+        // Skip this round while a dump owns the rings
+        if (xSemaphoreTake(s_drain_mutex, 0) == pdTRUE) {
+            count = drain_locked(records, TRACE_LOG_BATCH);
+            xSemaphoreGive(s_drain_mutex);
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            trace_format_record(&records[i], text, sizeof(text));
+            ESP_LOGI(TAG, "[%u] %10lu %s", records[i].core, (unsigned long)records[i].time_us, text);
+        }
+
+        // Keep draining while there is a backlog, otherwise sleep
+        if (count < TRACE_LOG_BATCH) {
+            vTaskDelay(pdMS_TO_TICKS(s_log_period_ms));
+        }
+    }
+}
+
+esp_err_t trace_start_log_task(uint8_t priority, uint32_t period_ms)
+{
+    if (s_log_task != NULL || s_rings == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_log_period_ms = period_ms ? period_ms : 1;
+    if (xTaskCreate(trace_log_task, "trace_log", 3072, NULL, priority, &s_log_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
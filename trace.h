@@ -0,0 +1,247 @@
+/**
+ * @file trace.h
+ * @brief Deferred binary trace logging
+ *
+ * This file contains the declarations for the binary trace facility used on
+ * the report -> mapping -> output path instead of ESP_LOGx. A trace point
+ * stores a format ID and up to TRACE_MAX_ARGS raw 32-bit arguments into a
+ * per-core lock-free ring; no formatting happens at the call site. Records
+ * are decoded later, either by an optional low-priority task on the device or
+ * by the host decoder (tools/trace_decode.c) from a dump written by
+ * trace_dump_to() or served on `/api/trace/dump`, using the format table in
+ * trace_formats.def.
+ *
+ * Usage:
+ *   TRACE(TRACE_CAN_RX, message->id, message->dlc, matched);
+ *
+ * The host decoder defines TRACE_HOST before including this file to get the
+ * record and dump layouts without the device-only declarations.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifndef TRACE_HOST
+#include "esp_http_server.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of arguments per trace record
+ */
+#define TRACE_MAX_ARGS 4
+
+/**
+ * @brief Number of records in each per-core ring (power of two)
+ */
+#define TRACE_RING_SIZE 256
+
+/**
+ * @brief Number of per-core rings
+ */
+#define TRACE_NUM_CORES 2
+
+/**
+ * @brief Trace dump magic ("TRC1")
+ */
+#define TRACE_DUMP_MAGIC 0x31435254
+
+/**
+ * @brief Trace dump format version (2 added the shared time_us time base)
+ */
+#define TRACE_DUMP_VERSION 2
+
+/**
+ * @brief Trace categories, switchable at runtime with trace_set_categories()
+ */
+typedef enum {
+    TRACE_CAT_SYSTEM    = 1 << 0,    /*!< Boot and system events */
+    TRACE_CAT_HID       = 1 << 1,    /*!< HID reports */
+    TRACE_CAT_MAPPING   = 1 << 2,    /*!< Mapping evaluation and outputs */
+    TRACE_CAT_SERIAL    = 1 << 3,    /*!< Serial output */
+    TRACE_CAT_CAN       = 1 << 4,    /*!< CAN bus traffic */
+    TRACE_CAT_TELEMETRY = 1 << 5,    /*!< Telemetry stream */
+    TRACE_CAT_OTA       = 1 << 6,    /*!< Firmware update */
+    TRACE_CAT_ALL       = 0xFFFFFFFF /*!< All categories */
+} trace_category_t;
+
+/**
+ * @brief Trace format IDs, generated from trace_formats.def
+ */
+typedef enum {
+#define TRACE_FORMAT(name, category, format) name,
+#include "trace_formats.def"
+#undef TRACE_FORMAT
+    TRACE_FORMAT_COUNT
+} trace_format_id_t;
+
+/**
+ * @brief Category of each trace format, generated from trace_formats.def
+ */
+enum {
+#define TRACE_FORMAT(name, category, format) TRACE_CATEGORY_OF_##name = (category),
+#include "trace_formats.def"
+#undef TRACE_FORMAT
+};
+
+/**
+ * @brief Trace record (also the on-disk record format of a dump)
+ */
+typedef struct {
+    uint32_t seq;                    /*!< Per-core sequence number + 1 (0 while being written) */
+    uint32_t timestamp;              /*!< CPU cycle count of the recording core, for sub-microsecond intervals on that core */
+    uint32_t time_us;                /*!< esp_timer time in microseconds (low 32 bits), shared by both cores */
+    uint16_t format_id;              /*!< Format ID (trace_format_id_t) */
+    uint8_t core;                    /*!< Core that recorded the event */
+    uint8_t nargs;                   /*!< Number of valid arguments */
+    uint32_t args[TRACE_MAX_ARGS];   /*!< Raw arguments */
+} trace_record_t;
+
+/**
+ * @brief Trace dump header, followed by record_count trace_record_t records
+ */
+typedef struct {
+    uint32_t magic;                  /*!< TRACE_DUMP_MAGIC */
+    uint16_t version;                /*!< TRACE_DUMP_VERSION */
+    uint16_t record_size;            /*!< sizeof(trace_record_t) */
+    uint32_t cpu_freq_hz;            /*!< CPU frequency, for converting cycle counts */
+    uint16_t format_count;           /*!< TRACE_FORMAT_COUNT of the producing firmware */
+    uint16_t reserved;               /*!< Reserved */
+    uint32_t record_count;           /*!< Number of records that follow */
+    uint32_t lost;                   /*!< Records overwritten before they were drained */
+} trace_dump_header_t;
+
+/**
+ * @brief Enabled category mask (read by the TRACE macro)
+ */
+extern volatile uint32_t trace_category_mask;
+
+/**
+ * @brief Record a trace event (use the TRACE macro instead)
+ *
+ * @param format_id Format ID
+ * @param nargs Number of arguments
+ * @param args Pointer to the arguments
+ */
+void trace_write(uint16_t format_id, uint8_t nargs, const uint32_t *args);
+
+#define TRACE_NARGS_(_0, _1, _2, _3, _4, n, ...) n
+#define TRACE_NARGS(...) TRACE_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+
+/**
+ * @brief Record a trace event if its category is enabled
+ *
+ * @param name Format name from trace_formats.def
+ * @param ... Up to TRACE_MAX_ARGS integer arguments
+ */
+#define TRACE(name, ...) do {                                                       \
+        if (trace_category_mask & TRACE_CATEGORY_OF_##name) {                       \
+            const uint32_t trace_args_[TRACE_MAX_ARGS + 1] = { 0, ##__VA_ARGS__ };  \
+            trace_write(name, TRACE_NARGS(__VA_ARGS__), &trace_args_[1]);           \
+        }                                                                           \
+    } while (0)
+
+/**
+ * @brief Initialize the trace rings
+ *
+ * The rings are allocated from the internal (MEM_ARENA_HOT) arena, so
+ * mem_arena_init() must have run.
+ *
+ * @param categories Initially enabled categories
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t trace_init(uint32_t categories);
+
+/**
+ * @brief Set the enabled trace categories
+ *
+ * @param categories Category mask (trace_category_t bits)
+ */
+void trace_set_categories(uint32_t categories);
+
+/**
+ * @brief Get the enabled trace categories
+ *
+ * @return uint32_t Category mask
+ */
+uint32_t trace_get_categories(void);
+
+/**
+ * @brief Drain recorded events from all rings
+ *
+ * Readers are serialized, so this blocks while a dump is being written.
+ *
+ * @param[out] records Array to store the records
+ * @param max_records Size of the array
+ * @param[out] count Pointer to store the number of records drained
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t trace_drain(trace_record_t *records, size_t max_records, size_t *count);
+
+/**
+ * @brief Fill a dump header for records about to be written
+ *
+ * @param[out] header Pointer to the header
+ * @param record_count Number of records that follow the header
+ */
+void trace_fill_dump_header(trace_dump_header_t *header, uint32_t record_count);
+
+/**
+ * @brief Write a dump of everything recorded so far to a file or socket
+ *
+ * Drains the rings into a PSRAM scratch buffer and writes a
+ * trace_dump_header_t followed by the records. The dump owns draining while
+ * it runs; the log task, if started, skips its rounds until it finishes.
+ *
+ * @param fd File or socket descriptor
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the bulk arena is unavailable,
+ *                   ESP_FAIL if a write failed
+ */
+esp_err_t trace_dump_to(int fd);
+
+#ifndef TRACE_HOST
+/**
+ * @brief Register the trace endpoints on the web server
+ *
+ * `GET /api/trace/dump` returns a binary dump (as trace_dump_to()),
+ * `GET /api/trace/categories` the enabled category mask and
+ * `POST /api/trace/categories?mask=N` sets it.
+ *
+ * @param server HTTP server handle
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t trace_register_handlers(httpd_handle_t server);
+#endif
+
+/**
+ * @brief Format a record as text using the format table
+ *
+ * @param record Pointer to the record
+ * @param[out] buf Buffer to store the text
+ * @param size Size of the buffer
+ * @return int Number of characters written (as snprintf)
+ */
+int trace_format_record(const trace_record_t *record, char *buf, size_t size);
+
+/**
+ * @brief Start a low-priority task that drains the rings and logs decoded records
+ *
+ * Optional: records it logs are no longer available to a dump, so leave it
+ * off when traces are collected with trace_dump_to() or `/api/trace/dump`.
+ *
+ * @param priority Task priority (should be below all real-time tasks)
+ * @param period_ms Drain period in milliseconds
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t trace_start_log_task(uint8_t priority, uint32_t period_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,313 @@
+/**
+ * @file tunerstudio_protocol.c
+ * @brief TunerStudio MS2 serial framing and page access implementation
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+
+#include "tunerstudio_protocol.h"
+#include "tunerstudio_realtime.h"
+
+static const char *TAG = "ts_protocol";
+
+// Size of the page command header: cmd, can id, page, offset (u16 BE), count (u16 BE)
+#define TS_PAGE_CMD_HEADER 7
+
+typedef enum {
+    PARSER_LENGTH = 0,
+    PARSER_PAYLOAD,
+    PARSER_CRC
+} parser_state_t;
+
+typedef struct {
+    bool registered;
+    uint8_t *data;
+    uint16_t size;
+    ts_page_burn_callback_t burn_cb;
+    void *user_ctx;
+} ts_page_t;
+
+static ts_page_t s_pages[TS_MAX_PAGES];
+
+// Serialises page writes against page reads and burns. Realtime polls never take it.
+static SemaphoreHandle_t s_page_mutex = NULL;
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = (value >> 16) & 0xFF;
+    p[2] = (value >> 8) & 0xFF;
+    p[3] = value & 0xFF;
+}
+
+uint32_t ts_crc32(const uint8_t *data, size_t len)
+{
+    return esp_rom_crc32_le(0, data, len);
+}
+
+esp_err_t ts_frame_encode(const uint8_t *payload, uint16_t len, uint8_t *frame, size_t frame_size, size_t *frame_len)
+{
+    if (payload == NULL || frame == NULL || frame_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (frame_size < (size_t)len + TS_FRAME_OVERHEAD) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    frame[0] = len >> 8;
+    frame[1] = len & 0xFF;
+    memmove(&frame[2], payload, len);
+    put_u32(&frame[2 + len], ts_crc32(&frame[2], len));
+
+    *frame_len = len + TS_FRAME_OVERHEAD;
+    return ESP_OK;
+}
+
+void ts_frame_parser_reset(ts_frame_parser_t *parser)
+{
+    parser->state = PARSER_LENGTH;
+    parser->length = 0;
+    parser->pos = 0;
+    parser->crc = 0;
+}
+
+esp_err_t ts_frame_parser_feed(ts_frame_parser_t *parser, const uint8_t *data, size_t len,
+                               size_t *consumed, bool *complete)
+{
+    if (parser == NULL || data == NULL || consumed == NULL || complete == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t i = 0;
+    *complete = false;
+
+    while (i < len) {
+        if (parser->state == PARSER_PAYLOAD) {
+            // Copy as much of the payload as is available in one go
+            size_t remaining = parser->length - parser->pos;
+            size_t n = remaining < len - i ? remaining : len - i;
+            memcpy(&parser->payload[parser->pos], &data[i], n);
+            parser->pos += n;
+            i += n;
+            if (parser->pos == parser->length) {
+                parser->state = PARSER_CRC;
+                parser->pos = 0;
+                parser->crc = 0;
+            }
+            continue;
+        }
+
+        uint8_t byte = data[i++];
+
+        if (parser->state == PARSER_LENGTH) {
+            parser->length = (parser->length << 8) | byte;
+            if (++parser->pos == 2) {
+                if (parser->length == 0 || parser->length > TS_MAX_PAYLOAD_SIZE) {
+                    ts_frame_parser_reset(parser);
+                    *consumed = i;
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                parser->state = PARSER_PAYLOAD;
+                parser->pos = 0;
+            }
+            continue;
+        }
+
+        // PARSER_CRC
+        parser->crc = (parser->crc << 8) | byte;
+        if (++parser->pos == 4) {
+            bool valid = parser->crc == ts_crc32(parser->payload, parser->length);
+            uint16_t length = parser->length;
+            ts_frame_parser_reset(parser);
+            *consumed = i;
+            if (!valid) {
+                return ESP_ERR_INVALID_CRC;
+            }
+            // Keep the payload length available to the caller
+            parser->length = length;
+            *complete = true;
+            return ESP_OK;
+        }
+    }
+
+    *consumed = i;
+    return ESP_OK;
+}
+
+esp_err_t ts_page_register(uint8_t page, uint8_t *data, uint16_t size,
+                           ts_page_burn_callback_t burn_cb, void *user_ctx)
+{
+    if (page >= TS_MAX_PAGES || data == NULL || size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_page_mutex == NULL) {
+        s_page_mutex = xSemaphoreCreateMutex();
+        if (s_page_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(s_page_mutex, portMAX_DELAY);
+    s_pages[page].registered = true;
+    s_pages[page].data = data;
+    s_pages[page].size = size;
+    s_pages[page].burn_cb = burn_cb;
+    s_pages[page].user_ctx = user_ctx;
+    xSemaphoreGive(s_page_mutex);
+
+    ESP_LOGI(TAG, "Registered page %d (%d bytes)", page, size);
+    return ESP_OK;
+}
+
+static bool page_range_valid(uint8_t page, uint16_t offset, uint16_t count)
+{
+    return page < TS_MAX_PAGES && s_pages[page].registered &&
+           count <= TS_MAX_CHUNK_SIZE && (uint32_t)offset + count <= s_pages[page].size;
+}
+
+esp_err_t ts_page_read(uint8_t page, uint16_t offset, uint16_t count, uint8_t *out)
+{
+    if (out == NULL || s_page_mutex == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_page_mutex, portMAX_DELAY);
+    if (!page_range_valid(page, offset, count)) {
+        xSemaphoreGive(s_page_mutex);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out, &s_pages[page].data[offset], count);
+    xSemaphoreGive(s_page_mutex);
+    return ESP_OK;
+}
+
+esp_err_t ts_page_write(uint8_t page, uint16_t offset, const uint8_t *data, uint16_t count)
+{
+    if (data == NULL || s_page_mutex == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_page_mutex, portMAX_DELAY);
+    if (!page_range_valid(page, offset, count)) {
+        xSemaphoreGive(s_page_mutex);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&s_pages[page].data[offset], data, count);
+    xSemaphoreGive(s_page_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t page_crc(uint8_t page, uint32_t *crc)
+{
+    if (page >= TS_MAX_PAGES || !s_pages[page].registered || s_page_mutex == NULL) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(s_page_mutex, portMAX_DELAY);
+    *crc = ts_crc32(s_pages[page].data, s_pages[page].size);
+    xSemaphoreGive(s_page_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t page_burn(uint8_t page)
+{
+    if (page >= TS_MAX_PAGES || !s_pages[page].registered || s_page_mutex == NULL) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(s_page_mutex, portMAX_DELAY);
+    if (s_pages[page].burn_cb != NULL) {
+        ret = s_pages[page].burn_cb(page, s_pages[page].data, s_pages[page].size, s_pages[page].user_ctx);
+    }
+    xSemaphoreGive(s_page_mutex);
+    return ret;
+}
+
+esp_err_t ts_handle_request(const uint8_t *request, size_t request_len,
+                            uint8_t *response, size_t response_size, size_t *response_len)
+{
+    if (request == NULL || request_len == 0 || response == NULL || response_len == NULL || response_size < 5) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t cmd = request[0];
+    *response_len = 1;
+
+    switch (cmd) {
+    case 'A': {
+        ts_realtime_snapshot_t snapshot;
+        if (response_size < 1 + TS_REALTIME_OUTPC_SIZE) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (ts_realtime_read(&snapshot) != ESP_OK) {
+            response[0] = TS_STATUS_BUSY;
+            return ESP_OK;
+        }
+        response[0] = TS_STATUS_REALTIME;
+        *response_len += ts_realtime_serialize(&snapshot, &response[1]);
+        return ESP_OK;
+    }
+
+    case 'r':
+    case 'w':
+    case 'k': {
+        if (request_len < TS_PAGE_CMD_HEADER) {
+            response[0] = TS_STATUS_OUT_OF_RANGE;
+            return ESP_OK;
+        }
+        uint8_t page = request[2];
+        uint16_t offset = get_u16(&request[3]);
+        uint16_t count = get_u16(&request[5]);
+
+        if (cmd == 'r') {
+            if (response_size < 1 + (size_t)count ||
+                ts_page_read(page, offset, count, &response[1]) != ESP_OK) {
+                response[0] = TS_STATUS_OUT_OF_RANGE;
+                return ESP_OK;
+            }
+            response[0] = TS_STATUS_PAGE;
+            *response_len += count;
+        } else if (cmd == 'w') {
+            if (request_len != TS_PAGE_CMD_HEADER + (size_t)count ||
+                ts_page_write(page, offset, &request[TS_PAGE_CMD_HEADER], count) != ESP_OK) {
+                response[0] = TS_STATUS_OUT_OF_RANGE;
+                return ESP_OK;
+            }
+            response[0] = TS_STATUS_OK;
+        } else {
+            uint32_t crc;
+            if (page_crc(page, &crc) != ESP_OK) {
+                response[0] = TS_STATUS_OUT_OF_RANGE;
+                return ESP_OK;
+            }
+            response[0] = TS_STATUS_CRC_OK;
+            put_u32(&response[1], crc);
+            *response_len += 4;
+        }
+        return ESP_OK;
+    }
+
+    case 'b':
+        if (request_len < 3) {
+            response[0] = TS_STATUS_OUT_OF_RANGE;
+            return ESP_OK;
+        }
+        response[0] = page_burn(request[2]) == ESP_OK ? TS_STATUS_BURN_OK : TS_STATUS_OUT_OF_RANGE;
+        return ESP_OK;
+
+    default:
+        response[0] = TS_STATUS_UNRECOGNIZED;
+        return ESP_OK;
+    }
+}
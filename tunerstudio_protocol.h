@@ -0,0 +1,175 @@
+/**
+ * @file tunerstudio_protocol.h
+ * @brief TunerStudio MS2 serial framing and page access
+ *
+ * This file contains the declarations for the CRC32 framed ("newserial")
+ * variant of the MS2 protocol used by TunerStudio, and for chunked access to
+ * configuration pages. Page reads and writes are limited to
+ * TS_MAX_CHUNK_SIZE bytes per command so a large page transfer is split
+ * into short frames and realtime polls can be served in between.
+ *
+ * Frame layout: [payload length, u16 BE][payload][CRC32 of payload, u32 BE]
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of registered configuration pages
+ */
+#define TS_MAX_PAGES 4
+
+/**
+ * @brief Maximum number of page bytes transferred per read/write command
+ */
+#define TS_MAX_CHUNK_SIZE 256
+
+/**
+ * @brief Maximum frame payload size (write command header plus one chunk)
+ */
+#define TS_MAX_PAYLOAD_SIZE (7 + TS_MAX_CHUNK_SIZE)
+
+/**
+ * @brief Framing overhead in bytes (length prefix and CRC32)
+ */
+#define TS_FRAME_OVERHEAD 6
+
+/**
+ * @brief Response status codes (first byte of every response payload)
+ */
+typedef enum {
+    TS_STATUS_OK = 0x00,             /*!< Command accepted */
+    TS_STATUS_REALTIME = 0x01,       /*!< Realtime data follows */
+    TS_STATUS_PAGE = 0x02,           /*!< Page data follows */
+    TS_STATUS_BURN_OK = 0x04,        /*!< Page burned to non-volatile storage */
+    TS_STATUS_CRC_OK = 0x07,         /*!< Page CRC follows */
+    TS_STATUS_CRC_FAILURE = 0x82,    /*!< Request frame failed CRC check */
+    TS_STATUS_UNRECOGNIZED = 0x83,   /*!< Unknown command */
+    TS_STATUS_OUT_OF_RANGE = 0x84,   /*!< Page, offset or count out of range */
+    TS_STATUS_BUSY = 0x85            /*!< Unable to service the request right now */
+} ts_status_t;
+
+/**
+ * @brief Page burn callback, invoked when TunerStudio requests a page to be saved
+ */
+typedef esp_err_t (*ts_page_burn_callback_t)(uint8_t page, const uint8_t *data, uint16_t size, void *user_ctx);
+
+/**
+ * @brief Incremental frame parser state
+ */
+typedef struct {
+    uint8_t state;                           /*!< Parser state (internal use) */
+    uint16_t length;                         /*!< Payload length of the current frame */
+    uint16_t pos;                            /*!< Bytes received in the current field */
+    uint32_t crc;                            /*!< Received CRC (internal use) */
+    uint8_t payload[TS_MAX_PAYLOAD_SIZE];    /*!< Payload of the current frame */
+} ts_frame_parser_t;
+
+/**
+ * @brief Compute the CRC32 (IEEE 802.3, as used by TunerStudio) of a buffer
+ *
+ * @param data Pointer to the data
+ * @param len Length of the data in bytes
+ * @return uint32_t CRC32 value
+ */
+uint32_t ts_crc32(const uint8_t *data, size_t len);
+
+/**
+ * @brief Encode a payload into a CRC32 framed packet
+ *
+ * @param payload Pointer to the payload
+ * @param len Payload length in bytes
+ * @param[out] frame Buffer to store the frame
+ * @param frame_size Size of the frame buffer (at least len + TS_FRAME_OVERHEAD)
+ * @param[out] frame_len Pointer to store the frame length
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if the buffer is too small
+ */
+esp_err_t ts_frame_encode(const uint8_t *payload, uint16_t len, uint8_t *frame, size_t frame_size, size_t *frame_len);
+
+/**
+ * @brief Reset a frame parser
+ *
+ * @param parser Pointer to the parser
+ */
+void ts_frame_parser_reset(ts_frame_parser_t *parser);
+
+/**
+ * @brief Feed received bytes to a frame parser
+ *
+ * Consumes bytes until a frame is complete or the input is exhausted, so the
+ * serial task never waits for a whole frame to arrive.
+ *
+ * @param parser Pointer to the parser
+ * @param data Pointer to the received bytes
+ * @param len Number of received bytes
+ * @param[out] consumed Pointer to store the number of bytes consumed
+ * @param[out] complete Pointer to store whether a complete valid frame is in parser->payload
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_CRC or ESP_ERR_INVALID_SIZE
+ *                   if a frame was rejected (the parser is reset)
+ */
+esp_err_t ts_frame_parser_feed(ts_frame_parser_t *parser, const uint8_t *data, size_t len,
+                               size_t *consumed, bool *complete);
+
+/**
+ * @brief Register a configuration page
+ *
+ * @param page Page number
+ * @param data Pointer to the page data (owned by the caller)
+ * @param size Page size in bytes
+ * @param burn_cb Callback invoked on burn requests (may be NULL)
+ * @param user_ctx User context passed to the callback
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ts_page_register(uint8_t page, uint8_t *data, uint16_t size,
+                           ts_page_burn_callback_t burn_cb, void *user_ctx);
+
+/**
+ * @brief Read a chunk of a configuration page
+ *
+ * @param page Page number
+ * @param offset Offset within the page
+ * @param count Number of bytes to read (at most TS_MAX_CHUNK_SIZE)
+ * @param[out] out Buffer to store the data
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ts_page_read(uint8_t page, uint16_t offset, uint16_t count, uint8_t *out);
+
+/**
+ * @brief Write a chunk of a configuration page
+ *
+ * @param page Page number
+ * @param offset Offset within the page
+ * @param data Pointer to the data
+ * @param count Number of bytes to write (at most TS_MAX_CHUNK_SIZE)
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ts_page_write(uint8_t page, uint16_t offset, const uint8_t *data, uint16_t count);
+
+/**
+ * @brief Handle a request payload and build the response payload
+ *
+ * Supported commands: 'A' (realtime data), 'r' (page read), 'w' (page write),
+ * 'k' (page CRC) and 'b' (burn page). Realtime data is taken from the
+ * lock-free snapshot, see tunerstudio_realtime.h.
+ *
+ * @param request Pointer to the request payload
+ * @param request_len Request payload length
+ * @param[out] response Buffer to store the response payload
+ * @param response_size Size of the response buffer
+ * @param[out] response_len Pointer to store the response payload length
+ * @return esp_err_t ESP_OK if a response was built, error code otherwise
+ */
+esp_err_t ts_handle_request(const uint8_t *request, size_t request_len,
+                            uint8_t *response, size_t response_size, size_t *response_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file tunerstudio_realtime.c
+ * @brief TunerStudio realtime data snapshot implementation
+ *
+ * Each buffer carries its own sequence counter which is odd while the buffer
+ * is being written. The publisher always writes the buffer that is not
+ * currently published, so a reader only retries if the publisher completes
+ * two publishes during a single copy.
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "tunerstudio_realtime.h"
+
+static const char *TAG = "ts_realtime";
+
+// Reader retries before giving up; only reached if the publisher laps the reader repeatedly
+#define TS_REALTIME_READ_RETRIES 8
+
+typedef struct {
+    atomic_uint seq;                 // Odd while the buffer is being written
+    ts_realtime_snapshot_t data;
+} ts_realtime_buffer_t;
+
+static ts_realtime_buffer_t s_buffers[2];
+static atomic_uint s_published;      // Number of publishes; buffer index is s_published & 1
+static bool s_updating = false;      // Publisher side only
+
+esp_err_t ts_realtime_init(void)
+{
+    memset(s_buffers, 0, sizeof(s_buffers));
+    atomic_store(&s_buffers[0].seq, 0);
+    atomic_store(&s_buffers[1].seq, 0);
+    atomic_store(&s_published, 0);
+    s_updating = false;
+
+    ESP_LOGI(TAG, "Realtime snapshot initialized (%d byte outpc block)", TS_REALTIME_OUTPC_SIZE);
+    return ESP_OK;
+}
+
+ts_realtime_snapshot_t *ts_realtime_begin_update(void)
+{
+    unsigned published = atomic_load_explicit(&s_published, memory_order_relaxed);
+    ts_realtime_buffer_t *front = &s_buffers[published & 1];
+    ts_realtime_buffer_t *back = &s_buffers[(published + 1) & 1];
+
+    // Already open: bumping seq again would make it even while still being written
+    if (s_updating) {
+        return &back->data;
+    }
+
+    atomic_fetch_add_explicit(&back->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Only this task writes the front buffer, so it can be read without checks
+    back->data = front->data;
+    s_updating = true;
+    return &back->data;
+}
+
+esp_err_t ts_realtime_publish(void)
+{
+    if (!s_updating) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    unsigned published = atomic_load_explicit(&s_published, memory_order_relaxed);
+    ts_realtime_buffer_t *back = &s_buffers[(published + 1) & 1];
+
+    back->data.sequence = published + 1;
+    back->data.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    atomic_fetch_add_explicit(&back->seq, 1, memory_order_release);
+    atomic_store_explicit(&s_published, published + 1, memory_order_release);
+    s_updating = false;
+    return ESP_OK;
+}
+
+esp_err_t ts_realtime_read(ts_realtime_snapshot_t *snapshot)
+{
+    if (snapshot == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int attempt = 0; attempt < TS_REALTIME_READ_RETRIES; attempt++) {
+        unsigned published = atomic_load_explicit(&s_published, memory_order_acquire);
+        ts_realtime_buffer_t *buffer = &s_buffers[published & 1];
+
+        unsigned seq_before = atomic_load_explicit(&buffer->seq, memory_order_acquire);
+        if (seq_before & 1) {
+            continue;
+        }
+
+        memcpy(snapshot, &buffer->data, sizeof(*snapshot));
+
+        atomic_thread_fence(memory_order_acquire);
+        unsigned seq_after = atomic_load_explicit(&buffer->seq, memory_order_relaxed);
+        if (seq_before == seq_after) {
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_TIMEOUT;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = (value >> 16) & 0xFF;
+    p[2] = (value >> 8) & 0xFF;
+    p[3] = value & 0xFF;
+    return p + 4;
+}
+
+size_t ts_realtime_serialize(const ts_realtime_snapshot_t *snapshot, uint8_t *outpc)
+{
+    uint8_t *p = outpc;
+
+    // Header
+    p = put_u32(p, snapshot->sequence);
+    p = put_u32(p, snapshot->timestamp_ms);
+    p = put_u16(p, snapshot->events_processed);
+    *p++ = snapshot->devices_connected;
+    *p++ = snapshot->reserved;
+
+    // Per-device inputs
+    for (int d = 0; d < MAX_HID_DEVICES; d++) {
+        for (int a = 0; a < TS_REALTIME_AXES_PER_DEVICE; a++) {
+            p = put_u16(p, (uint16_t)snapshot->axes[d][a]);
+        }
+        p = put_u32(p, snapshot->buttons[d]);
+    }
+
+    // Per-output counters
+    for (int c = 0; c < TS_REALTIME_OUTPUT_CHANNELS; c++) {
+        p = put_u32(p, snapshot->outputs_sent[c]);
+        p = put_u32(p, snapshot->output_errors[c]);
+    }
+
+    // Latency statistics
+    p = put_u32(p, snapshot->latency_min_us);
+    p = put_u32(p, snapshot->latency_avg_us);
+    p = put_u32(p, snapshot->latency_max_us);
+
+    return p - outpc;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file tunerstudio_realtime.h
+ * @brief TunerStudio realtime data snapshot
+ *
+ * This file contains the declarations for the realtime ("outpc") data block
+ * served to TunerStudio. The mapping task publishes a snapshot after each
+ * batch of events into one of two buffers; the TunerStudio handler copies out
+ * the latest complete buffer without taking any locks, so high-rate polling
+ * never contends with the mapping pipeline.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "hid_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Number of axis values reported per HID device
+ */
+#define TS_REALTIME_AXES_PER_DEVICE 8
+
+/**
+ * @brief Number of output channels with counters (serial ports 0-2 and CAN)
+ */
+#define TS_REALTIME_OUTPUT_CHANNELS 4
+
+/**
+ * @brief Output channel index of the CAN bus in the counter arrays
+ */
+#define TS_REALTIME_CHANNEL_CAN 3
+
+/**
+ * @brief Size of the serialised outpc block in bytes
+ */
+#define TS_REALTIME_OUTPC_SIZE (12 + MAX_HID_DEVICES * (TS_REALTIME_AXES_PER_DEVICE * 2 + 4) + \
+                                TS_REALTIME_OUTPUT_CHANNELS * 8 + 12)
+
+/**
+ * @brief Realtime data snapshot
+ */
+typedef struct {
+    uint32_t sequence;                                          /*!< Publish sequence number (set by publish) */
+    uint32_t timestamp_ms;                                      /*!< Time of publish in milliseconds since boot */
+    uint16_t events_processed;                                  /*!< HID events processed in the last batch */
+    uint8_t devices_connected;                                  /*!< Number of connected HID devices */
+    uint8_t reserved;                                           /*!< Reserved, keeps the layout aligned */
+    int16_t axes[MAX_HID_DEVICES][TS_REALTIME_AXES_PER_DEVICE]; /*!< Axis values per device */
+    uint32_t buttons[MAX_HID_DEVICES];                          /*!< Button bitfield per device */
+    uint32_t outputs_sent[TS_REALTIME_OUTPUT_CHANNELS];         /*!< Outputs sent per channel */
+    uint32_t output_errors[TS_REALTIME_OUTPUT_CHANNELS];        /*!< Output failures per channel */
+    uint32_t latency_min_us;                                    /*!< Minimum input-to-output latency */
+    uint32_t latency_avg_us;                                    /*!< Average input-to-output latency */
+    uint32_t latency_max_us;                                    /*!< Maximum input-to-output latency */
+} ts_realtime_snapshot_t;
+
+/**
+ * @brief Initialize the realtime snapshot buffers
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ts_realtime_init(void);
+
+/**
+ * @brief Begin updating the realtime snapshot
+ *
+ * Returns the back buffer, pre-filled with the last published snapshot so the
+ * caller only needs to update the fields that changed. Must only be called
+ * from the single publishing task (the mapping task). Calling it again before
+ * ts_realtime_publish() returns the same buffer with its pending changes.
+ *
+ * @return ts_realtime_snapshot_t* Pointer to the buffer to fill
+ */
+ts_realtime_snapshot_t *ts_realtime_begin_update(void);
+
+/**
+ * @brief Publish the buffer returned by ts_realtime_begin_update()
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if no update is in progress
+ */
+esp_err_t ts_realtime_publish(void);
+
+/**
+ * @brief Copy out the latest complete snapshot
+ *
+ * Lock-free; safe to call from any task concurrently with publishing.
+ *
+ * @param[out] snapshot Pointer to store the snapshot
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT if the publisher kept
+ *                   overtaking the reader
+ */
+esp_err_t ts_realtime_read(ts_realtime_snapshot_t *snapshot);
+
+/**
+ * @brief Serialise a snapshot into the big-endian outpc block layout
+ *
+ * @param snapshot Pointer to the snapshot
+ * @param[out] outpc Buffer of at least TS_REALTIME_OUTPC_SIZE bytes
+ * @return size_t Number of bytes written (TS_REALTIME_OUTPC_SIZE)
+ */
+size_t ts_realtime_serialize(const ts_realtime_snapshot_t *snapshot, uint8_t *outpc);
+
+#ifdef __cplusplus
+}
+#endif